@@ -51,6 +51,212 @@
 	 */
 	#define UINT32(x) ((uint32_t)((x) & 0xffffffff))
 
+	/**
+	 * @brief Base address of scratch pages mapped by benchmarks.
+	 *
+	 * @details It should fall into an unused region of the user address
+	 * space. Override it with ADDONS=-DKBENCH_SCRATCH_VIRT=<addr> if
+	 * needed.
+	 */
+	#ifndef KBENCH_SCRATCH_VIRT
+		#define KBENCH_SCRATCH_VIRT (UBASE_VIRT + 8*MB)
+	#endif
+
+/*============================================================================*
+ * Time Functions                                                             *
+ *============================================================================*/
+
+	/**
+	 * @brief Frequency of the clock read by kclock() (in Hz).
+	 *
+	 * @details Override it with ADDONS=-DKBENCH_CLOCK_FREQ=<hz> if the
+	 * target runs at a different frequency.
+	 */
+	#ifndef KBENCH_CLOCK_FREQ
+		#if defined(__mppa256__)
+			#define KBENCH_CLOCK_FREQ 400000000ULL
+		#elif defined(__optimsoc__)
+			#define KBENCH_CLOCK_FREQ 50000000ULL
+		#else
+			#define KBENCH_CLOCK_FREQ 1000000000ULL
+		#endif
+	#endif
+
+	/**
+	 * @brief Converts an event count over a time interval into a rate.
+	 *
+	 * @param n      Number of events.
+	 * @param cycles Time interval (in clock cycles).
+	 *
+	 * @returns The number of events per second.
+	 */
+	static inline uint64_t cycles_to_rate(uint64_t n, uint64_t cycles)
+	{
+		return ((cycles == 0) ? 0 : (n*KBENCH_CLOCK_FREQ)/cycles);
+	}
+
+/*============================================================================*
+ * Random Numbers                                                             *
+ *============================================================================*/
+
+	/**
+	 * @brief Generates a pseudo-random number (xorshift32).
+	 *
+	 * @param seed Generator state. It must not be zero.
+	 *
+	 * @returns A pseudo-random number.
+	 */
+	static inline uint32_t rand_next(uint32_t *seed)
+	{
+		uint32_t x = *seed;
+
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+
+		return (*seed = x);
+	}
+
+	/**
+	 * @brief Generates a uniformly distributed number in (0, 1].
+	 *
+	 * @param seed Generator state.
+	 */
+	static inline float rand_uniform(uint32_t *seed)
+	{
+		return (((rand_next(seed) >> 8) + 1)*(1.0f/16777216.0f));
+	}
+
+	/**
+	 * @brief Computes the natural logarithm of a positive number.
+	 *
+	 * @param x Target number.
+	 */
+	static inline float flog(float x)
+	{
+		int e = 0;
+		float z;
+		float z2;
+
+		/* Reduce to [0.5, 1). */
+		while (x >= 1.0f)
+		{
+			x *= 0.5f;
+			e++;
+		}
+		while (x < 0.5f)
+		{
+			x *= 2.0f;
+			e--;
+		}
+
+		/* ln(x) = 2*atanh((x - 1)/(x + 1)). */
+		z = (x - 1.0f)/(x + 1.0f);
+		z2 = z*z;
+
+		return (
+			2.0f*z*(1.0f + z2*(1.0f/3 + z2*(1.0f/5 + z2*(1.0f/7 + z2*(1.0f/9))))) +
+			e*0.69314718f
+		);
+	}
+
+	/**
+	 * @brief Generates an exponentially distributed number.
+	 *
+	 * @param seed Generator state.
+	 * @param mean Mean of the distribution.
+	 */
+	static inline float rand_exponential(uint32_t *seed, float mean)
+	{
+		return (-flog(rand_uniform(seed))*mean);
+	}
+
+/*============================================================================*
+ * Statistics Functions                                                       *
+ *============================================================================*/
+
+	/**
+	 * @brief Sorts samples in ascending order (shell sort).
+	 *
+	 * @param v Samples.
+	 * @param n Number of samples.
+	 */
+	static inline void samples_sort(uint64_t *v, int n)
+	{
+		for (int gap = n/2; gap > 0; gap /= 2)
+		{
+			for (int i = gap; i < n; i++)
+			{
+				int j;
+				uint64_t tmp = v[i];
+
+				for (j = i; (j >= gap) && (v[j - gap] > tmp); j -= gap)
+					v[j] = v[j - gap];
+
+				v[j] = tmp;
+			}
+		}
+	}
+
+	/**
+	 * @brief Gets a percentile of sorted samples.
+	 *
+	 * @param v        Sorted samples.
+	 * @param n        Number of samples.
+	 * @param permille Target percentile (in tenths of percent).
+	 */
+	static inline uint64_t samples_percentile(const uint64_t *v, int n, int permille)
+	{
+		return (v[((n - 1)*permille)/1000]);
+	}
+
+	/**
+	 * @brief Computes the fairness index of shares (Jain's index).
+	 *
+	 * @param x Shares.
+	 * @param n Number of shares.
+	 *
+	 * @returns The fairness index (in permille), which goes from 1000/n
+	 * when a single share takes everything to 1000 when all are even.
+	 */
+	static inline uint64_t fairness_index(const uint64_t *x, int n)
+	{
+		uint64_t sum = 0;
+		uint64_t sumsq = 0;
+
+		for (int i = 0; i < n; i++)
+		{
+			sum += x[i];
+			sumsq += x[i]*x[i];
+		}
+
+		return ((sumsq == 0) ? 1000 : (sum*sum*1000)/(n*sumsq));
+	}
+
+	/**
+	 * @brief Number of bins in a histogram.
+	 */
+	#define HISTOGRAM_BINS 32
+
+	/**
+	 * @brief Adds a sample to a histogram with power-of-two bins.
+	 *
+	 * @param bins Target histogram.
+	 * @param x    Sample.
+	 *
+	 * @details Bin i counts samples in [2^i, 2^(i + 1)), bin zero also
+	 * counts zero and the last one counts anything beyond it.
+	 */
+	static inline void histogram_add(uint32_t *bins, uint64_t x)
+	{
+		int i = 0;
+
+		while (((x >>= 1) != 0) && (i < (HISTOGRAM_BINS - 1)))
+			i++;
+
+		bins[i]++;
+	}
+
 /*============================================================================*
  * Memory Functions                                                           *
  *============================================================================*/
@@ -60,7 +266,7 @@
 	 *
 	 * @param ptr Pointer to target memory area.
 	 * @param c   Character to use.
-	 * @param n   Number of bytes to be set.
+	 * @param n   Number of words to be set.
 	 */
 	static inline void memfill(word_t *ptr, word_t c, size_t n)
 	{
@@ -78,7 +284,7 @@
 	 *
 	 * @param dest Target memory area.
 	 * @param src  Source memory area.
-	 * @param n    Number of bytes to be copied.
+	 * @param n    Number of words to be copied.
 	 */
 	static inline void memcopy(word_t *dest, const word_t *src, size_t n)
 	{
@@ -93,4 +299,378 @@
 			*d++ = *s++;
 	}
 
+	/**
+	 * @brief Fills words in memory, eight at a time.
+	 *
+	 * @param ptr Pointer to target memory area.
+	 * @param c   Character to use.
+	 * @param n   Number of words to be set.
+	 */
+	static inline void memfill_unrolled(word_t *ptr, word_t c, size_t n)
+	{
+		size_t i;
+
+		for (i = 0; (i + 8) <= n; i += 8)
+		{
+			ptr[i + 0] = c;
+			ptr[i + 1] = c;
+			ptr[i + 2] = c;
+			ptr[i + 3] = c;
+			ptr[i + 4] = c;
+			ptr[i + 5] = c;
+			ptr[i + 6] = c;
+			ptr[i + 7] = c;
+		}
+
+		/* Remainder. */
+		for ( ; i < n; i++)
+			ptr[i] = c;
+	}
+
+	/**
+	 * @brief Copy words in memory, eight at a time.
+	 *
+	 * @param dest Target memory area.
+	 * @param src  Source memory area.
+	 * @param n    Number of words to be copied.
+	 */
+	static inline void memcopy_unrolled(word_t *dest, const word_t *src, size_t n)
+	{
+		size_t i;
+
+		for (i = 0; (i + 8) <= n; i += 8)
+		{
+			dest[i + 0] = src[i + 0];
+			dest[i + 1] = src[i + 1];
+			dest[i + 2] = src[i + 2];
+			dest[i + 3] = src[i + 3];
+			dest[i + 4] = src[i + 4];
+			dest[i + 5] = src[i + 5];
+			dest[i + 6] = src[i + 6];
+			dest[i + 7] = src[i + 7];
+		}
+
+		/* Remainder. */
+		for ( ; i < n; i++)
+			dest[i] = src[i];
+	}
+
+	/**
+	 * @brief Wide word.
+	 *
+	 * @details The compiler lowers it to SIMD registers where the target
+	 * has them, and to pairs of words otherwise. It is only word-aligned,
+	 * so it may be used over any word boundary.
+	 */
+	typedef word_t wword_t __attribute__((vector_size(16), aligned(WORD_SIZE)));
+
+	/**
+	 * @brief Number of words in a wide word.
+	 */
+	#define WWORD_WORDS (sizeof(wword_t)/WORD_SIZE)
+
+	/**
+	 * @brief Fills words in memory, a wide word at a time.
+	 *
+	 * @param ptr Pointer to target memory area.
+	 * @param c   Character to use.
+	 * @param n   Number of words to be set.
+	 */
+	static inline void memfill_wide(word_t *ptr, word_t c, size_t n)
+	{
+		size_t i;
+		wword_t w;
+
+		for (i = 0; i < WWORD_WORDS; i++)
+			w[i] = c;
+
+		for (i = 0; (i + 2*WWORD_WORDS) <= n; i += 2*WWORD_WORDS)
+		{
+			*((wword_t *) &ptr[i]) = w;
+			*((wword_t *) &ptr[i + WWORD_WORDS]) = w;
+		}
+
+		/* Remainder. */
+		for ( ; i < n; i++)
+			ptr[i] = c;
+	}
+
+	/**
+	 * @brief Copy words in memory, a wide word at a time.
+	 *
+	 * @param dest Target memory area.
+	 * @param src  Source memory area.
+	 * @param n    Number of words to be copied.
+	 */
+	static inline void memcopy_wide(word_t *dest, const word_t *src, size_t n)
+	{
+		size_t i;
+
+		for (i = 0; (i + 2*WWORD_WORDS) <= n; i += 2*WWORD_WORDS)
+		{
+			*((wword_t *) &dest[i]) = *((const wword_t *) &src[i]);
+			*((wword_t *) &dest[i + WWORD_WORDS]) = *((const wword_t *) &src[i + WWORD_WORDS]);
+		}
+
+		/* Remainder. */
+		for ( ; i < n; i++)
+			dest[i] = src[i];
+	}
+
+#if defined(__unix64__) && defined(__x86_64__)
+
+	/**
+	 * @brief Stores a word bypassing caches.
+	 */
+	#define STORE_NT(p, v) \
+		__asm__ __volatile__ ("movnti %1, %0" : "=m" (*(p)) : "r" (v))
+
+	/**
+	 * @brief Fills words in memory with non-temporal stores.
+	 *
+	 * @param ptr Pointer to target memory area.
+	 * @param c   Character to use.
+	 * @param n   Number of words to be set.
+	 */
+	static inline void memfill_nt(word_t *ptr, word_t c, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+			STORE_NT(&ptr[i], c);
+
+		__asm__ __volatile__ ("sfence" ::: "memory");
+	}
+
+	/**
+	 * @brief Copy words in memory with non-temporal stores.
+	 *
+	 * @param dest Target memory area.
+	 * @param src  Source memory area.
+	 * @param n    Number of words to be copied.
+	 */
+	static inline void memcopy_nt(word_t *dest, const word_t *src, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+			STORE_NT(&dest[i], src[i]);
+
+		__asm__ __volatile__ ("sfence" ::: "memory");
+	}
+
+#endif
+
+	/**
+	 * @brief Implementation of memory functions.
+	 */
+	struct memops
+	{
+		const char *name;                               /**< Name          */
+		void (*fill)(word_t *, word_t, size_t);         /**< Fills words.  */
+		void (*copy)(word_t *, const word_t *, size_t); /**< Copies words. */
+	};
+
+	/**
+	 * @brief Implementations of memory functions, selectable at runtime.
+	 */
+	static const struct memops memops[] = {
+		{ "scalar",   memfill,          memcopy          },
+		{ "unrolled", memfill_unrolled, memcopy_unrolled },
+		{ "wide",     memfill_wide,     memcopy_wide     },
+#if defined(__unix64__) && defined(__x86_64__)
+		{ "nt",       memfill_nt,       memcopy_nt       },
+#endif
+	};
+
+	/**
+	 * @brief Number of implementations of memory functions.
+	 */
+	#define MEMOPS_NUM ((int) (sizeof(memops)/sizeof(memops[0])))
+
+/*============================================================================*
+ * Allocation Functions                                                       *
+ *============================================================================*/
+
+	/**
+	 * @brief Arena.
+	 *
+	 * @details An arena hands out memory by bumping an offset into a
+	 * region owned by a single thread. Blocks are not released one by
+	 * one: the arena rewinds once all of them are released, which others
+	 * may do concurrently.
+	 */
+	struct arena
+	{
+		char *base;         /**< Region             */
+		size_t size;        /**< Size of the Region */
+		size_t used;        /**< Bytes Handed Out   */
+		volatile int nlive; /**< Live Blocks        */
+	};
+
+	/**
+	 * @brief Initializes an arena.
+	 *
+	 * @param a    Target arena.
+	 * @param base Region of the arena.
+	 * @param size Size of the region (in bytes).
+	 */
+	static inline void arena_init(struct arena *a, void *base, size_t size)
+	{
+		a->base = base;
+		a->size = size;
+		a->used = 0;
+		a->nlive = 0;
+	}
+
+	/**
+	 * @brief Allocates a block from an arena.
+	 *
+	 * @param a    Target arena.
+	 * @param size Size of the block (in bytes).
+	 *
+	 * @returns A word-aligned block, or NULL if the arena is full.
+	 *
+	 * @details Only the owner of the arena may call this.
+	 */
+	static inline void *arena_alloc(struct arena *a, size_t size)
+	{
+		void *ptr;
+
+		size = (size + WORD_SIZE - 1) & ~((size_t) WORD_SIZE - 1);
+
+		/* Rewind. */
+		if (a->nlive == 0)
+			a->used = 0;
+
+		if (size > (a->size - a->used))
+			return (NULL);
+
+		ptr = &a->base[a->used];
+		a->used += size;
+		__sync_fetch_and_add(&a->nlive, 1);
+
+		return (ptr);
+	}
+
+	/**
+	 * @brief Releases a block to an arena.
+	 *
+	 * @param a Target arena.
+	 */
+	static inline void arena_free(struct arena *a)
+	{
+		__sync_fetch_and_sub(&a->nlive, 1);
+	}
+
+	/**
+	 * @brief Slab pool.
+	 *
+	 * @details A slab pool carves a region owned by a single thread into
+	 * objects of a fixed size, and keeps free ones in a list. Other
+	 * threads release objects to a separate list, which the owner takes
+	 * over at once when its own runs out.
+	 */
+	struct slab
+	{
+		char *base;            /**< Region                  */
+		size_t size;           /**< Size of the Region      */
+		size_t objsize;        /**< Size of Objects         */
+		void *free;            /**< Free Objects            */
+		void *volatile remote; /**< Objects Freed by Others */
+	};
+
+	/**
+	 * @brief Initializes a slab pool.
+	 *
+	 * @param s       Target slab pool.
+	 * @param base    Word-aligned region of the slab pool.
+	 * @param size    Size of the region (in bytes).
+	 * @param objsize Size of objects (in bytes).
+	 */
+	static inline void slab_init(struct slab *s, void *base, size_t size, size_t objsize)
+	{
+		objsize = (objsize + WORD_SIZE - 1) & ~((size_t) WORD_SIZE - 1);
+		if (objsize < sizeof(void *))
+			objsize = sizeof(void *);
+
+		s->base = base;
+		s->size = size;
+		s->objsize = objsize;
+		s->free = NULL;
+		s->remote = NULL;
+
+		/* Thread free objects, lowest addresses first. */
+		for (size_t off = (size/objsize)*objsize; off >= objsize; off -= objsize)
+		{
+			*((void **) &s->base[off - objsize]) = s->free;
+			s->free = &s->base[off - objsize];
+		}
+	}
+
+	/**
+	 * @brief Checks whether an object belongs to a slab pool.
+	 *
+	 * @param s   Target slab pool.
+	 * @param ptr Target object.
+	 */
+	static inline int slab_owns(const struct slab *s, const void *ptr)
+	{
+		return (((const char *) ptr >= s->base) && ((const char *) ptr < &s->base[s->size]));
+	}
+
+	/**
+	 * @brief Allocates an object from a slab pool.
+	 *
+	 * @param s Target slab pool.
+	 *
+	 * @returns An object, or NULL if the slab pool is empty.
+	 *
+	 * @details Only the owner of the slab pool may call this.
+	 */
+	static inline void *slab_alloc(struct slab *s)
+	{
+		void *ptr;
+
+		if (s->free == NULL)
+		{
+			if (s->remote == NULL)
+				return (NULL);
+
+			s->free = __sync_lock_test_and_set(&s->remote, NULL);
+		}
+
+		ptr = s->free;
+		s->free = *((void **) ptr);
+
+		return (ptr);
+	}
+
+	/**
+	 * @brief Releases an object to a slab pool.
+	 *
+	 * @param s   Target slab pool.
+	 * @param ptr Target object.
+	 *
+	 * @details Only the owner of the slab pool may call this.
+	 */
+	static inline void slab_free(struct slab *s, void *ptr)
+	{
+		*((void **) ptr) = s->free;
+		s->free = ptr;
+	}
+
+	/**
+	 * @brief Releases an object to a slab pool owned by another thread.
+	 *
+	 * @param s   Target slab pool.
+	 * @param ptr Target object.
+	 */
+	static inline void slab_free_remote(struct slab *s, void *ptr)
+	{
+		void *head;
+
+		do
+		{
+			head = s->remote;
+			*((void **) ptr) = head;
+		} while (__sync_val_compare_and_swap(&s->remote, head, ptr) != head);
+	}
+
 #endif /* _KBENCH_H_ */
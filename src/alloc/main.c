@@ -0,0 +1,796 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include <nanvix/ulib.h>
+#include <posix/stdint.h>
+#include <kbench.h>
+#include "../comm/comm.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                2  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP               2  /**< Increment on Number of Working Threads */
+#define NSLOTS                     32  /**< Live Blocks per Thread                 */
+#define NROUNDS                    64  /**< Rounds of Fixed-Size Pattern           */
+#define NOPS                     4096  /**< Operations per Thread                  */
+#define RING_SIZE                  16  /**< Blocks in Flight per Pair              */
+#define BLOCK_SIZE                 64  /**< Size of Fixed-Size Blocks (bytes)      */
+#define BLOCK_SIZE_MIN              8  /**< Smallest Mixed-Size Block (bytes)      */
+/**@}*/
+
+/**
+ * @brief Largest mixed-size block (in bytes).
+ *
+ * @details All threads together may hold NSLOTS of these at once, so
+ * keep it within the heap of the target.
+ */
+#ifndef BLOCK_SIZE_MAX
+	#if defined(__mppa256__)
+		#define BLOCK_SIZE_MAX 128
+	#elif defined(__optimsoc__)
+		#define BLOCK_SIZE_MAX 256
+	#else
+		#define BLOCK_SIZE_MAX 1024
+	#endif
+#endif
+
+/**
+ * @brief Horizontal line.
+ */
+const char *HLINE =
+	"------------------------------------------------------------------------";
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS;          /**< Number of Working Threads */
+static const char *PATTERN;   /**< Allocation Pattern        */
+static const char *ALLOCATOR; /**< Allocator                 */
+/**@}*/
+
+/*============================================================================*
+ * Profiling                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "alloc"
+
+/**
+ * @brief Number of events to profile.
+ */
+#if defined(__mppa256__)
+	#define BENCHMARK_PERF_EVENTS 7
+#elif defined(__optimsoc__)
+	#define BENCHMARK_PERF_EVENTS 7
+#else
+	#define BENCHMARK_PERF_EVENTS 1
+#endif
+
+/**
+ * Performance events.
+ */
+static int perf_events[BENCHMARK_PERF_EVENTS] = {
+#if defined(__mppa256__)
+	PERF_DTLB_STALLS,
+	PERF_ITLB_STALLS,
+	PERF_REG_STALLS,
+	PERF_BRANCH_STALLS,
+	PERF_DCACHE_STALLS,
+	PERF_ICACHE_STALLS,
+	PERF_CYCLES
+#elif defined(__optimsoc__)
+	MOR1KX_PERF_LSU_HITS,
+	MOR1KX_PERF_BRANCH_STALLS,
+	MOR1KX_PERF_ICACHE_HITS,
+	MOR1KX_PERF_REG_STALLS,
+	MOR1KX_PERF_ICACHE_MISSES,
+	MOR1KX_PERF_IFETCH_STALLS,
+	MOR1KX_PERF_LSU_STALLS,
+#else
+	0
+#endif
+};
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param nops   Operations performed by all threads.
+ * @param cycles Time for all threads to perform them (in cycles).
+ * @param stats  Execution statistics of the master thread.
+ */
+static void benchmark_dump_stats(
+	int it,
+	const char *name,
+	uint64_t nops,
+	uint64_t cycles,
+	uint64_t *stats
+)
+{
+	uprintf(
+#if defined(__mppa256__)
+		"[benchmarks][%s] %d %s %s %d %d %d %d %d %d %d %d %d %d",
+#elif defined(__optimsoc__)
+		"[benchmarks][%s] %d %s %s %d %d %d %d %d %d %d %d %d %d",
+#else
+		"[benchmarks][%s] %d %s %s %d %d %d %d",
+#endif
+		name,
+		it,
+		PATTERN,
+		ALLOCATOR,
+		NTHREADS,
+		UINT32(cycles),
+		UINT32(cycles_to_rate(nops, cycles)),
+#if defined(__mppa256__) || defined(__optimsoc__)
+		UINT32(stats[0]),
+		UINT32(stats[1]),
+		UINT32(stats[2]),
+		UINT32(stats[3]),
+		UINT32(stats[4]),
+		UINT32(stats[5]),
+		UINT32(stats[6])
+#else
+		UINT32(stats[0])
+#endif
+	);
+}
+
+/**
+ * @brief Dump memory usage.
+ *
+ * @param it        Benchmark iteration.
+ * @param name      Benchmark name.
+ * @param peak      Peak of live bytes.
+ * @param footprint Address range spanned by blocks of each thread, summed.
+ * @param nfailures Failed allocations.
+ *
+ * @details Fragmentation is the share of the footprint (in tenths of
+ * percent) that never held live data at the peak.
+ */
+static void benchmark_dump_footprint(
+	int it,
+	const char *name,
+	uint64_t peak,
+	uint64_t footprint,
+	uint64_t nfailures
+)
+{
+	uint64_t frag;
+
+	frag = (footprint > peak) ? (1000*(footprint - peak))/footprint : 0;
+
+	uprintf("[benchmarks][%s][f] %d %s %s %d %d %d %d %d",
+		name,
+		it,
+		PATTERN,
+		ALLOCATOR,
+		NTHREADS,
+		UINT32(peak),
+		UINT32(footprint),
+		UINT32(frag),
+		UINT32(nfailures)
+	);
+}
+
+/*============================================================================*
+ * Allocators                                                                 *
+ *============================================================================*/
+
+/**
+ * @brief Ring of blocks between a producer and a consumer.
+ */
+struct ring
+{
+	void *volatile blocks[RING_SIZE]; /**< Blocks          */
+	volatile size_t sizes[RING_SIZE]; /**< Sizes of Blocks */
+	volatile unsigned head;           /**< Produced Blocks */
+	volatile unsigned tail;           /**< Consumed Blocks */
+	volatile size_t freed;            /**< Bytes Released  */
+};
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tnum;                  /**< Thread Number          */
+	uint32_t seed;             /**< Random Generator State */
+	const struct pattern *p;   /**< Allocation Pattern     */
+	const struct allocator *a; /**< Allocator              */
+	struct arena arena;        /**< Own Arena              */
+	struct slab slab;          /**< Own Slab Pool          */
+	struct ring *ring;         /**< Ring of the Pair       */
+	uint64_t nops;             /**< Operations Performed   */
+	uint64_t nfailures;        /**< Failed Allocations     */
+	uint64_t live;             /**< Live Bytes             */
+	uint64_t peak;             /**< Peak of Live Bytes     */
+	uintptr_t lo;              /**< Lowest Block Address   */
+	uintptr_t hi;              /**< Highest Block End      */
+	void *slots[NSLOTS];       /**< Live Blocks            */
+	size_t sizes[NSLOTS];      /**< Sizes of Live Blocks   */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Rings of producer-consumer pairs.
+ */
+static struct ring rings[NTHREADS_MAX/2] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Size of the heap of each thread (in bytes).
+ */
+#define HEAP_SIZE (NSLOTS*BLOCK_SIZE_MAX)
+
+/**
+ * @brief Heaps of arenas and slab pools.
+ */
+static char heaps[NTHREADS_MAX][HEAP_SIZE] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Gets the thread that owns a block.
+ *
+ * @param ptr Target block.
+ */
+static struct tdata *heap_owner(void *ptr)
+{
+	return (&tdata[((char *) ptr - &heaps[0][0])/HEAP_SIZE]);
+}
+
+/**
+ * @brief Lock of the system allocator.
+ */
+static spinlock_t system_lock;
+
+/**
+ * @brief Allocates a block with the system allocator.
+ *
+ * @param t    Calling thread.
+ * @param size Size of the block (in bytes).
+ *
+ * @details The user-level allocator is not thread-safe, so callers
+ * serialize on a lock, like any multithreaded user of it would.
+ */
+static void *system_alloc(struct tdata *t, size_t size)
+{
+	void *ptr;
+
+	UNUSED(t);
+
+	spinlock_lock(&system_lock);
+		ptr = umalloc(size);
+	spinlock_unlock(&system_lock);
+
+	return (ptr);
+}
+
+/**
+ * @brief Releases a block to the system allocator.
+ *
+ * @param t   Calling thread.
+ * @param ptr Target block.
+ */
+static void system_free(struct tdata *t, void *ptr)
+{
+	UNUSED(t);
+
+	spinlock_lock(&system_lock);
+		ufree(ptr);
+	spinlock_unlock(&system_lock);
+}
+
+/**
+ * @brief Resets the arena of a thread.
+ *
+ * @param t Target thread.
+ */
+static void arena_setup(struct tdata *t)
+{
+	arena_init(&t->arena, heaps[t->tnum], HEAP_SIZE);
+}
+
+/**
+ * @brief Allocates a block from the arena of a thread.
+ *
+ * @param t    Calling thread.
+ * @param size Size of the block (in bytes).
+ */
+static void *arena_alloc_block(struct tdata *t, size_t size)
+{
+	return (arena_alloc(&t->arena, size));
+}
+
+/**
+ * @brief Releases a block to the arena it came from.
+ *
+ * @param t   Calling thread.
+ * @param ptr Target block.
+ */
+static void arena_free_block(struct tdata *t, void *ptr)
+{
+	UNUSED(t);
+
+	arena_free(&heap_owner(ptr)->arena);
+}
+
+/**
+ * @brief Resets the slab pool of a thread.
+ *
+ * @param t Target thread.
+ *
+ * @details Objects fit the largest mixed-size block.
+ */
+static void slab_setup(struct tdata *t)
+{
+	slab_init(&t->slab, heaps[t->tnum], HEAP_SIZE, BLOCK_SIZE_MAX);
+}
+
+/**
+ * @brief Allocates a block from the slab pool of a thread.
+ *
+ * @param t    Calling thread.
+ * @param size Size of the block (in bytes).
+ */
+static void *slab_alloc_block(struct tdata *t, size_t size)
+{
+	if (size > t->slab.objsize)
+		return (NULL);
+
+	return (slab_alloc(&t->slab));
+}
+
+/**
+ * @brief Releases a block to the slab pool it came from.
+ *
+ * @param t   Calling thread.
+ * @param ptr Target block.
+ */
+static void slab_free_block(struct tdata *t, void *ptr)
+{
+	struct tdata *owner = heap_owner(ptr);
+
+	if (owner == t)
+		slab_free(&t->slab, ptr);
+	else
+		slab_free_remote(&owner->slab, ptr);
+}
+
+/**
+ * @brief Allocators.
+ *
+ * @details Arenas and slab pools of kbench.h carve the heap of each
+ * thread, and blocks go back to the thread that allocated them. An
+ * arena reclaims space only once all of its blocks are released, so it
+ * runs only the patterns that drain.
+ */
+static const struct allocator
+{
+	const char *name;                             /**< Allocator Name         */
+	int rewinds;                                  /**< Reclaims When Drained? */
+	void (*setup)(struct tdata *t);               /**< Resets (if any)        */
+	void *(*alloc)(struct tdata *t, size_t size); /**< Allocates              */
+	void (*free)(struct tdata *t, void *ptr);     /**< Releases               */
+} allocators[] = {
+	{ "umalloc", 0, NULL,        system_alloc,      system_free      },
+	{ "arena",   1, arena_setup, arena_alloc_block, arena_free_block },
+	{ "slab",    0, slab_setup,  slab_alloc_block,  slab_free_block  },
+};
+
+/**
+ * @brief Number of allocators.
+ */
+#define NALLOCATORS ((int) (sizeof(allocators)/sizeof(allocators[0])))
+
+/*============================================================================*
+ * Patterns                                                                   *
+ *============================================================================*/
+
+/**
+ * @brief Allocates a block and accounts for it.
+ *
+ * @param t    Calling thread.
+ * @param size Size of the block (in bytes).
+ *
+ * @details Failed allocations are not counted as operations.
+ */
+static void *tally_alloc(struct tdata *t, size_t size)
+{
+	void *ptr;
+
+	if ((ptr = t->a->alloc(t, size)) == NULL)
+	{
+		t->nfailures++;
+		return (NULL);
+	}
+
+	t->nops++;
+	t->live += size;
+	if (t->live > t->peak)
+		t->peak = t->live;
+	if ((uintptr_t) ptr < t->lo)
+		t->lo = (uintptr_t) ptr;
+	if (((uintptr_t) ptr + size) > t->hi)
+		t->hi = (uintptr_t) ptr + size;
+
+	return (ptr);
+}
+
+/**
+ * @brief Releases a block and accounts for it.
+ *
+ * @param t    Calling thread.
+ * @param ptr  Target block.
+ * @param size Size of the block (in bytes).
+ */
+static void tally_free(struct tdata *t, void *ptr, size_t size)
+{
+	t->nops++;
+	t->live -= size;
+	t->a->free(t, ptr);
+}
+
+/**
+ * @brief Allocates and releases blocks of a single size, in batches.
+ */
+static void pattern_fixed(struct tdata *t)
+{
+	for (int r = 0; r < NROUNDS; r++)
+	{
+		for (int i = 0; i < NSLOTS; i++)
+			t->slots[i] = tally_alloc(t, BLOCK_SIZE);
+
+		for (int i = 0; i < NSLOTS; i++)
+		{
+			if (t->slots[i] != NULL)
+				tally_free(t, t->slots[i], BLOCK_SIZE);
+		}
+	}
+}
+
+/**
+ * @brief Allocates and releases blocks of random sizes, in random order.
+ *
+ * @details Each operation picks a random slot, and releases its block
+ * if it holds one or fills it with a new block otherwise.
+ */
+static void pattern_mixed(struct tdata *t)
+{
+	for (int i = 0; i < NSLOTS; i++)
+		t->slots[i] = NULL;
+
+	for (int i = 0; i < NOPS; i++)
+	{
+		int j = rand_next(&t->seed)%NSLOTS;
+
+		if (t->slots[j] != NULL)
+		{
+			tally_free(t, t->slots[j], t->sizes[j]);
+			t->slots[j] = NULL;
+			continue;
+		}
+
+		t->sizes[j] = BLOCK_SIZE_MIN + rand_next(&t->seed)%(BLOCK_SIZE_MAX - BLOCK_SIZE_MIN + 1);
+		t->slots[j] = tally_alloc(t, t->sizes[j]);
+	}
+
+	for (int i = 0; i < NSLOTS; i++)
+	{
+		if (t->slots[i] != NULL)
+			tally_free(t, t->slots[i], t->sizes[i]);
+	}
+}
+
+/**
+ * @brief Passes blocks from producers, which allocate them, to
+ * consumers, which release them.
+ *
+ * @details Even threads produce and odd threads consume. Consumers
+ * report released bytes back through the ring, so that live bytes are
+ * accounted to the producer.
+ */
+static void pattern_pc(struct tdata *t)
+{
+	struct ring *r = t->ring;
+
+	/* Unpaired thread. */
+	if (r == NULL)
+		return;
+
+	/* Producer. */
+	if ((t->tnum & 1) == 0)
+	{
+		size_t seen = 0;
+
+		for (int i = 0; i < NOPS/2; i++)
+		{
+			size_t freed;
+			size_t size = BLOCK_SIZE_MIN + rand_next(&t->seed)%(BLOCK_SIZE_MAX - BLOCK_SIZE_MIN + 1);
+
+			while ((r->head - r->tail) == RING_SIZE)
+				/* noop */;
+
+			/* Catch up with released bytes. */
+			freed = r->freed;
+			t->live -= freed - seen;
+			seen = freed;
+
+			r->blocks[r->head%RING_SIZE] = tally_alloc(t, size);
+			r->sizes[r->head%RING_SIZE] = size;
+			__sync_synchronize();
+			r->head++;
+		}
+	}
+
+	/* Consumer. */
+	else
+	{
+		for (int i = 0; i < NOPS/2; i++)
+		{
+			void *ptr;
+			size_t size;
+
+			while (r->tail == r->head)
+				/* noop */;
+
+			ptr = r->blocks[r->tail%RING_SIZE];
+			size = r->sizes[r->tail%RING_SIZE];
+
+			if (ptr != NULL)
+			{
+				t->nops++;
+				t->a->free(t, ptr);
+				r->freed += size;
+			}
+
+			__sync_synchronize();
+			r->tail++;
+		}
+	}
+}
+
+/**
+ * @brief Allocation patterns.
+ */
+static const struct pattern
+{
+	const char *name;             /**< Pattern Name                   */
+	int drains;                   /**< Releases All Blocks Per Round? */
+	void (*run)(struct tdata *t); /**< Pattern Function               */
+} patterns[] = {
+	{ "fixed", 1, pattern_fixed },
+	{ "mixed", 0, pattern_mixed },
+	{ "pc",    0, pattern_pc    },
+};
+
+/**
+ * @brief Number of allocation patterns.
+ */
+#define NPATTERNS ((int) (sizeof(patterns)/sizeof(patterns[0])))
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Resets the accounting of a thread.
+ *
+ * @param t Target thread.
+ */
+static void tally_reset(struct tdata *t)
+{
+	t->nops = 0;
+	t->nfailures = 0;
+	t->live = 0;
+	t->peak = 0;
+	t->lo = ~((uintptr_t) 0);
+	t->hi = 0;
+
+	if (t->a->setup != NULL)
+		t->a->setup(t);
+
+	if (((t->tnum & 1) == 0) && (t->ring != NULL))
+	{
+		t->ring->head = 0;
+		t->ring->tail = 0;
+		t->ring->freed = 0;
+	}
+}
+
+/**
+ * @brief Dumps the accounting of all threads.
+ *
+ * @param it     Benchmark iteration.
+ * @param cycles Time for all threads to run the pattern (in cycles).
+ * @param stats  Execution statistics of the master thread.
+ *
+ * @details Peaks and footprints of threads are summed. The peak sum
+ * bounds the peak of live bytes from above, since threads need not
+ * peak at once.
+ */
+static void tally_dump(int it, uint64_t cycles, uint64_t *stats)
+{
+	uint64_t nops = 0;
+	uint64_t peak = 0;
+	uint64_t nfailures = 0;
+	uint64_t footprint = 0;
+
+	for (int i = 0; i < NTHREADS; i++)
+	{
+		nops += tdata[i].nops;
+		peak += tdata[i].peak;
+		nfailures += tdata[i].nfailures;
+		if (tdata[i].hi > tdata[i].lo)
+			footprint += tdata[i].hi - tdata[i].lo;
+	}
+
+	benchmark_dump_stats(it, BENCHMARK_NAME, nops, cycles, stats);
+	benchmark_dump_footprint(it, BENCHMARK_NAME, peak, footprint, nfailures);
+}
+
+/**
+ * @brief Runs the allocation pattern.
+ *
+ * @details Threads reset their accounting right after the first
+ * barrier, so that the master dumps it before anyone touches it again.
+ */
+static void *task(void *arg)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	struct tdata *t = arg;
+	uint64_t stats[BENCHMARK_PERF_EVENTS];
+
+	barrier_cores_setup(t->tnum, NTHREADS);
+
+	for (int i = 0; i < NITERATIONS + SKIP; i++)
+	{
+		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+		{
+			barrier_cores();
+			tally_reset(t);
+			barrier_cores();
+			if (t->tnum == 0)
+				kclock(&t0);
+
+			perf_start(0, perf_events[j]);
+
+				t->p->run(t);
+
+			perf_stop(0);
+			stats[j] = perf_read(0);
+
+			barrier_cores();
+			if (t->tnum == 0)
+				kclock(&t1);
+		}
+
+		if ((i >= SKIP) && (t->tnum == 0))
+			tally_dump(i - SKIP, t1 - t0, stats);
+	}
+
+	barrier_cores_cleanup(t->tnum);
+
+	return (NULL);
+}
+
+/**
+ * @brief Allocator Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ * @param pattern  Allocation pattern.
+ * @param a        Allocator.
+ */
+static void kernel_alloc(int nthreads, const struct pattern *pattern, const struct allocator *a)
+{
+	kthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+	PATTERN = pattern->name;
+	ALLOCATOR = a->name;
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		tdata[i].tnum = i;
+		tdata[i].seed = 2*i + 1;
+		tdata[i].p = pattern;
+		tdata[i].a = a;
+		tdata[i].ring = ((i | 1) < nthreads) ? &rings[i/2] : NULL;
+
+		kthread_create(&tid[i], task, &tdata[i]);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_join(tid[i], NULL);
+}
+
+#endif
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Allocator Benchmark
+ *
+ * @param argc Argument counter.
+ * @param argv Argument variables.
+ */
+int __main2(int argc, const char *argv[])
+{
+	((void) argc);
+	((void) argv);
+
+#ifndef __qemu_riscv32__
+
+	uprintf(HLINE);
+
+	spinlock_init(&system_lock);
+
+#ifndef NDEBUG
+
+	for (int i = 0; i < NPATTERNS; i++)
+	{
+		for (int j = 0; j < NALLOCATORS; j++)
+		{
+			if (allocators[j].rewinds && !patterns[i].drains)
+				continue;
+
+			kernel_alloc(NTHREADS_MIN, &patterns[i], &allocators[j]);
+		}
+	}
+
+#else
+
+	for (int i = 0; i < NPATTERNS; i++)
+	{
+		for (int j = 0; j < NALLOCATORS; j++)
+		{
+			if (allocators[j].rewinds && !patterns[i].drains)
+				continue;
+
+			for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+				kernel_alloc(nthreads, &patterns[i], &allocators[j]);
+		}
+	}
+
+#endif
+
+	uprintf(HLINE);
+
+#endif
+
+	return (0);
+}
@@ -27,6 +27,7 @@
 #include <posix/sys/types.h>
 #include <posix/stdint.h>
 #include <kbench.h>
+#include "../../comm/comm.h"
 
 /**
  * @name Benchmark Parameters
@@ -35,23 +36,76 @@
 #define NTHREADS_MIN                2  /**< Minimum Number of Working Threads      */
 #define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
 #define NTHREADS_STEP               4  /**< Increment on Number of Working Threads */
-#define OBJSIZE_MIN           (1*1024) /**< Minimum Object Size                    */
-#define OBJSIZE_MAX           (8*1024) /**< Maximum Object Size                    */
-#define OBJSIZE_STEP          (1*1024) /**< Object Size                            */
+#define SCALAR                      3  /**< Scalar of Scale and Triad Kernels      */
 /**@}*/
 
+/**
+ * @brief Words in a cache line.
+ */
+#define LINE_WORDS (CACHE_LINE_SIZE/WORD_SIZE)
+
+/**
+ * @brief Size of each array (in bytes).
+ *
+ * @details Arrays should be well beyond the size of the last cache
+ * level. Override it with ADDONS=-DARRAY_SIZE=<bytes> if needed.
+ */
+#ifndef ARRAY_SIZE
+	#if defined(__mppa256__)
+		#define ARRAY_SIZE (128*1024)
+	#elif defined(__optimsoc__)
+		#define ARRAY_SIZE (1024*1024)
+	#else
+		#define ARRAY_SIZE (32*1024*1024)
+	#endif
+#endif
+
+/**
+ * @brief Smallest working set (in bytes).
+ *
+ * @details Working sets double from this up to ARRAY_SIZE. It should
+ * leave at least a cache line of each array to every thread.
+ */
+#ifndef WSET_MIN
+	#define WSET_MIN (ARRAY_SIZE/64)
+#endif
+
 /**
  * @brief Horizontal line.
  */
-static const char *HLINE =
+const char *HLINE =
 	"------------------------------------------------------------------------";
 
+/**
+ * @name First-Touch Placements
+ *
+ * @details Placement decides which thread initializes the arrays of
+ * each partition. On targets that place pages on first touch, only the
+ * first run that touches a page decides where it lives, so pin a single
+ * layout and placement when that is what is being measured. Elsewhere,
+ * it decides which cache holds the dirty lines when kernels start.
+ */
+/**@{*/
+#define PLACEMENT_OWNER  0 /**< Each Thread Touches Its Partition */
+#define PLACEMENT_MASTER 1 /**< Master Touches All Partitions     */
+#define NPLACEMENTS      2 /**< Number of First-Touch Placements  */
+/**@}*/
+
+/**
+ * @brief Names of first-touch placements.
+ */
+static const char *placements[NPLACEMENTS] = {
+	"owner", "master"
+};
+
 /**
  * @name Benchmark Kernel Parameters
  */
 /**@{*/
-static int NTHREADS;   /**< Number of Working Threads */
-static size_t OBJSIZE; /**< Object Size               */
+static int NTHREADS;       /**< Number of Working Threads */
+static size_t NWORDS;      /**< Words per Array           */
+static const char *LAYOUT; /**< Array Layout              */
+static int PLACEMENT;      /**< First-Touch Placement     */
 /**@}*/
 
 /*============================================================================*
@@ -102,25 +156,36 @@ static int perf_events[BENCHMARK_PERF_EVENTS] = {
 /**
  * @brief Dump execution statistics.
  *
- * @param it      Benchmark iteration.
- * @oaram name    Benchmark name.
- * @param objsize Object size.
- * @param stats   Execution statistics.
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param kernel Kernel name.
+ * @param impl   Implementation of memory functions.
+ * @param stats  Execution statistics.
  */
-static void benchmark_dump_stats(int it, const char *name, size_t objsize, uint64_t *stats)
+static void benchmark_dump_stats(
+	int it,
+	const char *name,
+	const char *kernel,
+	const char *impl,
+	uint64_t *stats
+)
 {
 	uprintf(
 #if defined(__mppa256__)
-		"[benchmarks][%s] %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s] %d %s %s %s %s %d %d %d %d %d %d %d %d %d",
 #elif defined(__optimsoc__)
-		"[benchmarks][%s] %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s] %d %s %s %s %s %d %d %d %d %d %d %d %d %d",
 #else
-		"[benchmarks][%s] %d %d %d %d",
+		"[benchmarks][%s] %d %s %s %s %s %d %d %d",
 #endif
 		name,
 		it,
+		kernel,
+		impl,
+		LAYOUT,
+		placements[PLACEMENT],
 		NTHREADS,
-		objsize,
+		NWORDS*WORD_SIZE,
 #if defined(__mppa256__)
 		UINT32(stats[0]),
 		UINT32(stats[1]),
@@ -143,89 +208,357 @@ static void benchmark_dump_stats(int it, const char *name, size_t objsize, uint6
 	);
 }
 
+/**
+ * @brief Dump sustained bandwidth.
+ *
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param kernel Kernel name.
+ * @param impl   Implementation of memory functions.
+ * @param nbytes Bytes moved by all threads.
+ * @param cycles Time to move all bytes (in cycles).
+ */
+static void benchmark_dump_bandwidth(
+	int it,
+	const char *name,
+	const char *kernel,
+	const char *impl,
+	uint64_t nbytes,
+	uint64_t cycles
+)
+{
+	uprintf("[benchmarks][%s][b] %d %s %s %s %s %d %d %d %d %d",
+		name,
+		it,
+		kernel,
+		impl,
+		LAYOUT,
+		placements[PLACEMENT],
+		NTHREADS,
+		NWORDS*WORD_SIZE,
+		UINT32(nbytes),
+		UINT32(cycles),
+		UINT32(cycles_to_rate(nbytes, cycles)/1000000)
+	);
+}
+
 /*============================================================================*
- * Benchmark                                                                  *
+ * Layouts                                                                    *
  *============================================================================*/
 
+/**
+ * @brief Memory pool for arrays.
+ */
+static word_t pool[3*ARRAY_SIZE/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
+
 /**
  * @brief Thread info.
  */
 struct tdata
 {
-	int tnum;  /**< Thread Number */
-	size_t start; /**< Start Byte    */
-	size_t end;   /**< End Byte      */
+	int tnum;  /**< Thread Number           */
+	size_t n;  /**< Words in Each Partition */
+	word_t *a; /**< Partition of Array a    */
+	word_t *b; /**< Partition of Array b    */
+	word_t *c; /**< Partition of Array c    */
 } tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
 
 /**
- * @brief Buffers.
+ * @brief Lays out the partition of a thread in shared arrays.
+ *
+ * @param t     Target thread.
+ * @param start First word of the partition.
+ *
+ * @details Arrays span the whole pool, one after the other, and
+ * threads work on disjoint slices of each.
+ */
+static void layout_shared(struct tdata *t, size_t start)
+{
+	t->a = &pool[start];
+	t->b = &pool[ARRAY_SIZE/WORD_SIZE + start];
+	t->c = &pool[2*ARRAY_SIZE/WORD_SIZE + start];
+}
+
+/**
+ * @brief Lays out the partition of a thread in private arrays.
+ *
+ * @param t     Target thread.
+ * @param start First word of the partition.
+ *
+ * @details Each thread gets its three arrays in a contiguous region
+ * of the pool that no other thread touches.
  */
-/**@{*/
-static word_t obj1[OBJSIZE_MAX/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
-static word_t obj2[OBJSIZE_MAX/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
-/**@}*/
+static void layout_private(struct tdata *t, size_t start)
+{
+	t->a = &pool[3*start];
+	t->b = &pool[3*start + t->n];
+	t->c = &pool[3*start + 2*t->n];
+}
 
 /**
- * @brief Move Bytes in Memory
+ * @brief Array layouts.
  */
-static void *task(void *arg)
+static struct
 {
-	struct tdata *t = arg;
-	int start = t->start;
-	int end = t->end;
+	const char *name;                             /**< Layout Name     */
+	void (*place)(struct tdata *t, size_t start); /**< Layout Function */
+} layouts[] = {
+	{ "shared",  layout_shared  },
+	{ "private", layout_private },
+};
+
+/**
+ * @brief Number of array layouts.
+ */
+#define NLAYOUTS ((int) (sizeof(layouts)/sizeof(layouts[0])))
+
+/**
+ * @brief Initializes the arrays of a thread.
+ *
+ * @param t Target thread.
+ */
+static void stream_touch(struct tdata *t)
+{
+	memfill(t->a, 1, t->n);
+	memfill(t->b, 2, t->n);
+	memfill(t->c, 0, t->n);
+}
+
+/*============================================================================*
+ * Kernels                                                                    *
+ *============================================================================*/
+
+/**
+ * @brief c = a
+ */
+static void kernel_copy(const struct memops *m, struct tdata *t)
+{
+	word_t *a = t->a;
+	word_t *c = t->c;
+
+	UNUSED(m);
+
+	for (size_t i = 0; i < t->n; i++)
+		c[i] = a[i];
+}
+
+/**
+ * @brief b = SCALAR*c
+ */
+static void kernel_scale(const struct memops *m, struct tdata *t)
+{
+	word_t *b = t->b;
+	word_t *c = t->c;
+
+	UNUSED(m);
+
+	for (size_t i = 0; i < t->n; i++)
+		b[i] = SCALAR*c[i];
+}
+
+/**
+ * @brief c = a + b
+ */
+static void kernel_add(const struct memops *m, struct tdata *t)
+{
+	word_t *a = t->a;
+	word_t *b = t->b;
+	word_t *c = t->c;
+
+	UNUSED(m);
+
+	for (size_t i = 0; i < t->n; i++)
+		c[i] = a[i] + b[i];
+}
+
+/**
+ * @brief a = b + SCALAR*c
+ */
+static void kernel_triad(const struct memops *m, struct tdata *t)
+{
+	word_t *a = t->a;
+	word_t *b = t->b;
+	word_t *c = t->c;
+
+	UNUSED(m);
+
+	for (size_t i = 0; i < t->n; i++)
+		a[i] = b[i] + SCALAR*c[i];
+}
+
+/**
+ * @brief c = 0, with a memfill() implementation.
+ */
+static void kernel_memfill(const struct memops *m, struct tdata *t)
+{
+	m->fill(t->c, 0, t->n);
+}
+
+/**
+ * @brief c = a, with a memcopy() implementation.
+ */
+static void kernel_memcopy(const struct memops *m, struct tdata *t)
+{
+	m->copy(t->c, t->a, t->n);
+}
+
+/**
+ * @brief STREAM kernels.
+ *
+ * @details Moved bytes follow the STREAM convention, which does not
+ * account for write allocates. Kernels built on memory functions run
+ * once for each implementation of them in kbench.h.
+ */
+static struct
+{
+	const char *name;                                    /**< Kernel Name                */
+	int naccesses;                                       /**< Words Accessed per Element */
+	int memops;                                          /**< Uses Memory Functions?     */
+	void (*fn)(const struct memops *m, struct tdata *t); /**< Kernel Function            */
+} kernels[] = {
+	{ "copy",    2, 0, kernel_copy    },
+	{ "scale",   2, 0, kernel_scale   },
+	{ "add",     3, 0, kernel_add     },
+	{ "triad",   3, 0, kernel_triad   },
+	{ "memfill", 1, 1, kernel_memfill },
+	{ "memcopy", 2, 1, kernel_memcopy },
+};
+
+/**
+ * @brief Number of STREAM kernels.
+ */
+#define NKERNELS ((int) (sizeof(kernels)/sizeof(kernels[0])))
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Runs a STREAM kernel over the partition of a thread.
+ *
+ * @param t  Target thread.
+ * @param k  Target kernel.
+ * @param m  Memory functions used by the kernel (if any).
+ * @param it Benchmark iteration.
+ *
+ * @details Threads synchronize around the kernel, so that the master
+ * times all of them moving their partitions at once.
+ */
+static void stream_run(struct tdata *t, int k, const struct memops *m, int it)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	const char *impl = (m == NULL) ? "loop" : m->name;
 	uint64_t stats[BENCHMARK_PERF_EVENTS];
 
-	/* Warm up. */
-	memfill(&obj1[start], (word_t) - 1, end - start);
-	memfill(&obj2[start], 0, end - start);
+	for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+	{
+		barrier_cores();
+		if (t->tnum == 0)
+			kclock(&t0);
 
-	for (int i = 0; i < NITERATIONS + SKIP; i++)
+		perf_start(0, perf_events[j]);
+
+			kernels[k].fn(m, t);
+
+		perf_stop(0);
+		stats[j] = perf_read(0);
+
+		barrier_cores();
+		if (t->tnum == 0)
+			kclock(&t1);
+	}
+
+	if (it >= SKIP)
 	{
-		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+		benchmark_dump_stats(it - SKIP, BENCHMARK_NAME, kernels[k].name, impl, stats);
+
+		if (t->tnum == 0)
 		{
-			perf_start(0, perf_events[j]);
+			benchmark_dump_bandwidth(
+				it - SKIP,
+				BENCHMARK_NAME,
+				kernels[k].name,
+				impl,
+				kernels[k].naccesses*NWORDS*WORD_SIZE,
+				t1 - t0
+			);
+		}
+	}
+}
 
-				memcopy(&obj1[start], &obj2[start], end - start);
+/**
+ * @brief Runs STREAM kernels over the partition of a thread.
+ */
+static void *task(void *arg)
+{
+	struct tdata *t = arg;
 
-			perf_stop(0);
-			stats[j] = perf_read(0);
-		}
+	barrier_cores_setup(t->tnum, NTHREADS);
+
+	if (PLACEMENT == PLACEMENT_OWNER)
+		stream_touch(t);
 
-		if (i >= SKIP)
-			benchmark_dump_stats(i - SKIP, BENCHMARK_NAME, OBJSIZE, stats);
+	for (int i = 0; i < NITERATIONS + SKIP; i++)
+	{
+		for (int k = 0; k < NKERNELS; k++)
+		{
+			if (!kernels[k].memops)
+			{
+				stream_run(t, k, NULL, i);
+				continue;
+			}
+
+			for (int m = 0; m < MEMOPS_NUM; m++)
+				stream_run(t, k, &memops[m], i);
+		}
 	}
 
+	barrier_cores_cleanup(t->tnum);
+
 	return (NULL);
 }
 
 /**
- * @brief Memory Move Benchmark Kernel
+ * @brief STREAM Benchmark Kernel
  *
- * @param nthreads Number of working threads.
- * @param objsize  Object size.
+ * @param nthreads  Number of working threads.
+ * @param nwords    Words per array.
+ * @param layout    Array layout.
+ * @param placement First-touch placement.
+ *
+ * @details Partitions are rounded down to whole cache lines, so that
+ * no two threads write to the same line. The last thread takes what
+ * is left.
  */
-static void kernel_memmove(int nthreads, size_t objsize)
+static void kernel_stream(int nthreads, size_t nwords, int layout, int placement)
 {
-	size_t nbytes;
+	size_t chunk;
 	kthread_t tid[NTHREADS_MAX];
 
 	/* Save kernel parameters. */
 	NTHREADS = nthreads;
-	OBJSIZE = objsize;
+	NWORDS = nwords;
+	LAYOUT = layouts[layout].name;
+	PLACEMENT = placement;
 
-	nbytes = (OBJSIZE/WORD_SIZE)/nthreads;
+	chunk = ((NWORDS/nthreads)/LINE_WORDS)*LINE_WORDS;
 
-	/* Spawn threads. */
+	/* Initialize thread data structures. */
 	for (int i = 0; i < nthreads; i++)
 	{
-		/* Initialize thread data structure. */
-		tdata[i].start = nbytes*i;
-		tdata[i].end = (i == (nthreads - 1)) ? (OBJSIZE/WORD_SIZE) : (i + 1)*nbytes;
 		tdata[i].tnum = i;
+		tdata[i].n = (i == (nthreads - 1)) ? NWORDS - chunk*i : chunk;
+		layouts[layout].place(&tdata[i], chunk*i);
 
-		kthread_create(&tid[i], task, &tdata[i]);
+		if (placement == PLACEMENT_MASTER)
+			stream_touch(&tdata[i]);
 	}
 
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_create(&tid[i], task, &tdata[i]);
+
 	/* Wait for threads. */
 	for (int i = 0; i < nthreads; i++)
 		kthread_join(tid[i], NULL);
@@ -236,7 +569,7 @@ static void kernel_memmove(int nthreads, size_t objsize)
  *============================================================================*/
 
 /**
- * @brief Memory Move Benchmark
+ * @brief STREAM Benchmark
  *
  * @param argc Argument counter.
  * @param argv Argument variables.
@@ -250,14 +583,24 @@ int __main2(int argc, const char *argv[])
 
 #ifndef NDEBUG
 
-	kernel_memmove(1, OBJSIZE_MAX);
+	for (int l = 0; l < NLAYOUTS; l++)
+	{
+		for (int p = 0; p < NPLACEMENTS; p++)
+			kernel_stream(NTHREADS_MIN, ARRAY_SIZE/WORD_SIZE, l, p);
+	}
 
 #else
 
-	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+	for (int l = 0; l < NLAYOUTS; l++)
 	{
-		for (size_t objsize = OBJSIZE_MIN; objsize <= OBJSIZE_MAX; objsize += OBJSIZE_STEP)
-			kernel_memmove(nthreads, objsize);
+		for (int p = 0; p < NPLACEMENTS; p++)
+		{
+			for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+			{
+				for (size_t wset = WSET_MIN; wset <= ARRAY_SIZE; wset *= 2)
+					kernel_stream(nthreads, wset/WORD_SIZE, l, p);
+			}
+		}
 	}
 
 #endif
@@ -0,0 +1,500 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include "../comm.h"
+
+#if __TARGET_HAS_SYNC
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "barrier"
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP               1  /**< Increment on Number of Working Threads */
+#define NNODES_MIN                  2  /**< Minimum Number of Nodes                */
+#define NEPISODES                 128  /**< Barrier Episodes per Iteration         */
+/**@}*/
+
+/**
+ * @brief Delay of the late participant in skewed episodes (in cycles).
+ */
+#ifndef BARRIER_SKEW
+#define BARRIER_SKEW (KBENCH_CLOCK_FREQ/100000)
+#endif
+
+/**
+ * @brief Arrival skews.
+ */
+static const uint64_t skews[] = { 0, BARRIER_SKEW };
+
+/**
+ * @brief Number of arrival skews.
+ */
+#define NSKEWS ((int) (sizeof(skews)/sizeof(skews[0])))
+
+/**
+ * @brief Latencies of episodes.
+ */
+static uint64_t latencies[NEPISODES];
+
+/**
+ * @brief Delays the caller.
+ *
+ * @param start  Start of the delay.
+ * @param cycles Length of the delay (in cycles).
+ *
+ * @returns The time when the delay ends.
+ */
+static uint64_t delay(uint64_t start, uint64_t cycles)
+{
+	uint64_t now;
+
+	do
+		kclock(&now);
+	while ((now - start) < cycles);
+
+	return (now);
+}
+
+/**
+ * @brief Dump the latency distribution of barrier episodes.
+ *
+ * @param it    Benchmark iteration.
+ * @param name  Benchmark name.
+ * @param tag   Kind of barrier.
+ * @param algo  Barrier algorithm.
+ * @param n     Number of participants.
+ * @param skew  Arrival skew (in cycles).
+ */
+static void benchmark_dump(int it, const char *name, const char *tag, const char *algo, int n, uint64_t skew)
+{
+	samples_sort(latencies, NEPISODES);
+
+	uprintf("[benchmarks][%s][%s] %d %s %d %d %d %d %d %d %d",
+		name,
+		tag,
+		it,
+		algo,
+		n,
+		UINT32(skew),
+		UINT32(latencies[0]),
+		UINT32(samples_percentile(latencies, NEPISODES, 500)),
+		UINT32(samples_percentile(latencies, NEPISODES, 900)),
+		UINT32(samples_percentile(latencies, NEPISODES, 990)),
+		UINT32(latencies[NEPISODES - 1])
+	);
+}
+
+/*============================================================================*
+ * Cores                                                                      *
+ *============================================================================*/
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tid;         /**< Thread ID.               */
+	int nthreads;    /**< Number of threads.       */
+	uint64_t skew;   /**< Arrival skew.            */
+	int index;       /**< Index of the local node. */
+	int nnodes;      /**< Number of nodes.         */
+	int composition; /**< Barrier composition.     */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @name Timestamps of Episodes
+ */
+/**@{*/
+static uint64_t arrivals[NTHREADS_MAX][NEPISODES];   /**< Arrivals.   */
+static uint64_t departures[NTHREADS_MAX][NEPISODES]; /**< Departures. */
+/**@}*/
+
+/**
+ * @brief Goes through barrier episodes.
+ *
+ * @details In skewed episodes, threads take turns in arriving late.
+ */
+static void *task_cores(void *arg)
+{
+	struct tdata *t = arg;
+
+	barrier_cores_setup(t->tid, t->nthreads);
+
+	barrier_cores_wait(t->tid);
+
+	for (int e = 0; e < NEPISODES; e++)
+	{
+		kclock(&arrivals[t->tid][e]);
+
+		if ((t->skew > 0) && (t->tid == (e % t->nthreads)))
+			arrivals[t->tid][e] = delay(arrivals[t->tid][e], t->skew);
+
+		barrier_cores_wait(t->tid);
+
+		kclock(&departures[t->tid][e]);
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	return (NULL);
+}
+
+/**
+ * @brief Computes latencies of episodes of cores.
+ *
+ * @param nthreads Number of working threads.
+ *
+ * @details The latency of an episode goes from the last arrival to
+ * the last departure, so it does not account for skew.
+ */
+static void cores_latencies(int nthreads)
+{
+	for (int e = 0; e < NEPISODES; e++)
+	{
+		uint64_t arrival = 0;
+		uint64_t departure = 0;
+
+		for (int i = 0; i < nthreads; i++)
+		{
+			if (arrivals[i][e] > arrival)
+				arrival = arrivals[i][e];
+			if (departures[i][e] > departure)
+				departure = departures[i][e];
+		}
+
+		latencies[e] = departure - arrival;
+	}
+}
+
+/**
+ * @brief Barrier Benchmark of Cores
+ *
+ * @param nthreads Number of working threads.
+ */
+static void benchmark_cores(int nthreads)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	for (int a = 0; a < BARRIER_CORES_AVAILABLE; a++)
+	{
+		barrier_cores_select(a);
+
+		for (int s = 0; s < NSKEWS; s++)
+		{
+			for (int it = 0; it < NITERATIONS + SKIP; it++)
+			{
+				for (int i = 0; i < nthreads; i++)
+				{
+					tdata[i].tid = i;
+					tdata[i].nthreads = nthreads;
+					tdata[i].skew = skews[s];
+					kthread_create(&tids[i], task_cores, &tdata[i]);
+				}
+
+				for (int i = 0; i < nthreads; i++)
+					kthread_join(tids[i], NULL);
+
+				if (it >= SKIP)
+				{
+					cores_latencies(nthreads);
+					benchmark_dump(it - SKIP, BENCHMARK_NAME, "cores",
+						barrier_cores_names[a], nthreads, skews[s]
+					);
+				}
+			}
+		}
+	}
+
+	barrier_cores_select(BARRIER_CORES_CENTRAL);
+}
+
+/*============================================================================*
+ * Nodes                                                                      *
+ *============================================================================*/
+
+/**
+ * @brief Barrier of a prefix of involved nodes.
+ */
+static struct node_barrier barrier;
+
+/**
+ * @brief Barrier Benchmark of Nodes
+ *
+ * @param nodes  Involved nodes.
+ * @param nnodes Number of nodes in the barrier.
+ * @param index  Index of the local node.
+ *
+ * @details Clocks of nodes are not synchronized, so the latency of an
+ * episode is the time the master spends in it. Nodes take turns in
+ * arriving late in skewed episodes, thus latencies of these include
+ * the skew. The barrier of all involved nodes fences the setup and
+ * cleanup of the one being benchmarked.
+ */
+static void benchmark_nodes(const int *nodes, int nnodes, int index)
+{
+	int active = (index < nnodes);
+
+	for (int a = 0; a < BARRIER_NODES_NUM; a++)
+	{
+		if (active)
+			node_barrier_setup(&barrier, a, nodes, nnodes, (index == 0));
+
+		barrier_nodes();
+
+		if (active)
+		{
+			node_barrier_wait(&barrier);
+
+			for (int s = 0; s < NSKEWS; s++)
+			{
+				for (int it = 0; it < NITERATIONS + SKIP; it++)
+				{
+					for (int e = 0; e < NEPISODES; e++)
+					{
+						uint64_t t0, t1;
+
+						kclock(&t0);
+
+						if ((skews[s] > 0) && (index == (e % nnodes)))
+							delay(t0, skews[s]);
+
+						node_barrier_wait(&barrier);
+
+						kclock(&t1);
+
+						latencies[e] = t1 - t0;
+					}
+
+					if ((index == 0) && (it >= SKIP))
+					{
+						benchmark_dump(it - SKIP, BENCHMARK_NAME, "nodes",
+							barrier_nodes_names[a], nnodes, skews[s]
+						);
+					}
+				}
+			}
+		}
+
+		barrier_nodes();
+
+		if (active)
+			node_barrier_cleanup(&barrier);
+	}
+}
+
+/*============================================================================*
+ * Nodes and Cores                                                            *
+ *============================================================================*/
+
+/**
+ * @name Compositions of Barriers
+ */
+/**@{*/
+#define COMPOSITION_NAIVE  0 /**< Cores, nodes and cores again. */
+#define COMPOSITION_HYBRID 1 /**< Two-level barrier.            */
+#define NCOMPOSITIONS      2 /**< Number of compositions.       */
+/**@}*/
+
+/**
+ * @brief Names of compositions.
+ */
+static const char *compositions[NCOMPOSITIONS] = {
+	"naive", "hybrid"
+};
+
+/**
+ * @brief Naive barrier of all threads in all nodes.
+ *
+ * @param tid Thread ID.
+ *
+ * @details Threads combine with the same algorithm as in the two-level
+ * barrier, so that only the composition differs.
+ */
+static void barrier_naive(int tid)
+{
+	barrier_cores_wait(tid);
+
+	if (tid == 0)
+		barrier_nodes();
+
+	barrier_cores_wait(tid);
+}
+
+/**
+ * @brief Goes through barrier episodes of all threads in all nodes.
+ *
+ * @details In skewed episodes, threads of nodes take turns in arriving
+ * late. Only the first thread of the master node takes times.
+ */
+static void *task_hybrid(void *arg)
+{
+	struct tdata *t = arg;
+	int timer = (t->index == 0) && (t->tid == 0);
+
+	barrier_cores_setup(t->tid, t->nthreads);
+
+	barrier_naive(t->tid);
+
+	for (int e = 0; e < NEPISODES; e++)
+	{
+		uint64_t t0, t1;
+
+		kclock(&t0);
+
+		if ((t->skew > 0) && (t->index == (e % t->nnodes)) && (t->tid == (e % t->nthreads)))
+			delay(t0, t->skew);
+
+		if (t->composition == COMPOSITION_HYBRID)
+			barrier_hybrid(t->tid);
+		else
+			barrier_naive(t->tid);
+
+		kclock(&t1);
+
+		if (timer)
+			latencies[e] = t1 - t0;
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	return (NULL);
+}
+
+/**
+ * @brief Barrier Benchmark of Nodes and Cores
+ *
+ * @param nnodes   Number of involved nodes.
+ * @param index    Index of the local node.
+ * @param nthreads Number of working threads per node.
+ *
+ * @details Every involved node spawns the same number of threads,
+ * and all threads of all nodes meet at each episode.
+ */
+static void benchmark_hybrid(int nnodes, int index, int nthreads)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	barrier_cores_select(BARRIER_CORES_HYBRID);
+
+	for (int c = 0; c < NCOMPOSITIONS; c++)
+	{
+		for (int s = 0; s < NSKEWS; s++)
+		{
+			for (int it = 0; it < NITERATIONS + SKIP; it++)
+			{
+				for (int i = 0; i < nthreads; i++)
+				{
+					tdata[i].tid = i;
+					tdata[i].nthreads = nthreads;
+					tdata[i].skew = skews[s];
+					tdata[i].index = index;
+					tdata[i].nnodes = nnodes;
+					tdata[i].composition = c;
+					kthread_create(&tids[i], task_hybrid, &tdata[i]);
+				}
+
+				for (int i = 0; i < nthreads; i++)
+					kthread_join(tids[i], NULL);
+
+				if ((index == 0) && (it >= SKIP))
+				{
+					benchmark_dump(it - SKIP, BENCHMARK_NAME, "hybrid",
+						compositions[c], nthreads, skews[s]
+					);
+				}
+			}
+		}
+	}
+
+	barrier_cores_select(BARRIER_CORES_CENTRAL);
+}
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Barrier Latency Routine
+ */
+int do_barrier(const int * nodes, int nnodes, int index, int message_size)
+{
+	UNUSED(message_size);
+
+	KASSERT(nnodes <= MAX_NUM_NODES);
+
+	if (index == 0)
+	{
+#ifndef NDEBUG
+		benchmark_cores(NTHREADS_MAX);
+#else
+		for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+			benchmark_cores(nthreads);
+#endif
+	}
+
+#ifndef NDEBUG
+	benchmark_nodes(nodes, nnodes, index);
+#else
+	for (int n = NNODES_MIN; n <= nnodes; n++)
+		benchmark_nodes(nodes, n, index);
+#endif
+
+#ifndef NDEBUG
+	benchmark_hybrid(nnodes, index, NTHREADS_MAX);
+#else
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		benchmark_hybrid(nnodes, index, nthreads);
+#endif
+
+	return (0);
+}
+
+#else
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Barrier Latency Routine
+ */
+int do_barrier(const int * nodes, int nnodes, int index, int message_size)
+{
+	UNUSED(nodes);
+	UNUSED(nnodes);
+	UNUSED(index);
+	UNUSED(message_size);
+
+	return (0);
+}
+
+#endif /* __TARGET_HAS_SYNC */
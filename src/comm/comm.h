@@ -63,7 +63,101 @@
     extern void barrier_nodes_cleanup(void);
     extern void barrier_cores_setup(int tid, int ncores);
     extern void barrier_cores(void);
+    extern void barrier_cores_wait(int tid);
     extern void barrier_cores_cleanup(int tid);
+    extern void barrier_hybrid(int tid);
+    /**@}*/
+
+    /**
+     * @brief Barrier over a group of nodes.
+     */
+    struct barrier_group
+    {
+        int syncin;    /**< Input synchronization point.  */
+        int syncout;   /**< Output synchronization point. */
+        int is_master; /**< Is the local node the master? */
+    };
+
+    /**
+     * @name Barrier group functions
+     */
+    /**@{*/
+    extern void barrier_group_setup(struct barrier_group *g, const int * nodes, int nnodes, int is_master);
+    extern void barrier_group_wait(struct barrier_group *g);
+    extern void barrier_group_cleanup(struct barrier_group *g);
+    /**@}*/
+
+    /**
+     * @name Barrier algorithms of nodes
+     */
+    /**@{*/
+    #define BARRIER_NODES_FLAT 0 /**< Master gathers everyone (default). */
+    #define BARRIER_NODES_TREE 1 /**< Combining tree.                    */
+    #define BARRIER_NODES_NUM  2 /**< Number of algorithms.              */
+    /**@}*/
+
+    /**
+     * @brief Barrier of nodes.
+     */
+    struct node_barrier
+    {
+        int algorithm;             /**< Barrier algorithm.           */
+        int has_parent;            /**< Does it have a parent?       */
+        int has_children;          /**< Does it have children?       */
+        struct barrier_group up;   /**< Group shared with the parent. */
+        struct barrier_group down; /**< Group led by the local node.  */
+    };
+
+    /**
+     * @name Node barrier functions
+     */
+    /**@{*/
+    extern const char *barrier_nodes_names[BARRIER_NODES_NUM];
+    extern void barrier_nodes_select(int algorithm);
+    extern void node_barrier_setup(struct node_barrier *b, int algorithm, const int * nodes, int nnodes, int is_master);
+    extern void node_barrier_wait(struct node_barrier *b);
+    extern void node_barrier_cleanup(struct node_barrier *b);
+    /**@}*/
+
+    /**
+     * @name Barrier algorithms of cores
+     */
+    /**@{*/
+    #define BARRIER_CORES_CENTRAL       0 /**< Lock-polling fence (default). */
+    #define BARRIER_CORES_SENSE         1 /**< Sense-reversing counter.      */
+    #define BARRIER_CORES_TREE          2 /**< Combining tree.               */
+    #define BARRIER_CORES_DISSEMINATION 3 /**< Dissemination.                */
+    #define BARRIER_CORES_TOURNAMENT    4 /**< Tournament.                   */
+    #define BARRIER_CORES_NUM           5 /**< Number of algorithms.         */
+    /**@}*/
+
+    /**
+     * @brief Number of barrier algorithms of cores available.
+     *
+     * @details All but the fence spin on plain loads, which may never
+     * see an update when L1 caches are not coherent (mppa256).
+     */
+    #if defined(__mppa256__)
+        #define BARRIER_CORES_AVAILABLE 1
+    #else
+        #define BARRIER_CORES_AVAILABLE BARRIER_CORES_NUM
+    #endif
+
+    /**
+     * @brief Algorithm that barrier_hybrid() combines threads with.
+     */
+    #if defined(__mppa256__)
+        #define BARRIER_CORES_HYBRID BARRIER_CORES_CENTRAL
+    #else
+        #define BARRIER_CORES_HYBRID BARRIER_CORES_SENSE
+    #endif
+
+    /**
+     * @name Barrier algorithm selection
+     */
+    /**@{*/
+    extern const char *barrier_cores_names[BARRIER_CORES_NUM];
+    extern void barrier_cores_select(int algorithm);
     /**@}*/
 
     /**
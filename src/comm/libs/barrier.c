@@ -26,6 +26,8 @@
 #include <nanvix/ulib.h>
 #include <nanvix/sys/sync.h>
 #include <nanvix/sys/noc.h>
+#include <nanvix/sys/thread.h>
+#include "../comm.h"
 
 #if (__TARGET_HAS_SYNC)
 
@@ -33,48 +35,254 @@
  * Nodes                                                                      *
  *----------------------------------------------------------------------------*/
 
-static int _syncin         = -1;
-static int _syncout        = -1;
-static int _node_is_master = 0;
-
 /**
- * @brief Barrier setup function.
+ * @brief Sets up a barrier group.
+ *
+ * @param g         Target group.
+ * @param nodes     Nodes in the group (master first).
+ * @param nnodes    Number of nodes in the group.
+ * @param is_master Is the local node the master of the group?
  */
-void barrier_nodes_setup(const int * nodes, int nnodes, int is_master)
+void barrier_group_setup(struct barrier_group *g, const int * nodes, int nnodes, int is_master)
 {
-	KASSERT((nodes != NULL) && (nnodes > 0));
+	KASSERT((g != NULL) && (nodes != NULL) && (nnodes > 0));
 
-	_node_is_master = is_master;
+	g->is_master = is_master;
 
-	if (_node_is_master)
+	if (g->is_master)
 	{
-		_syncin  = ksync_create(nodes, nnodes, SYNC_ALL_TO_ONE);
-		_syncout = ksync_open(nodes, nnodes, SYNC_ONE_TO_ALL);
+		g->syncin  = ksync_create(nodes, nnodes, SYNC_ALL_TO_ONE);
+		g->syncout = ksync_open(nodes, nnodes, SYNC_ONE_TO_ALL);
 	}
 	else
 	{
-		_syncout = ksync_open(nodes, nnodes, SYNC_ALL_TO_ONE);
-		_syncin  = ksync_create(nodes, nnodes, SYNC_ONE_TO_ALL);
+		g->syncout = ksync_open(nodes, nnodes, SYNC_ALL_TO_ONE);
+		g->syncin  = ksync_create(nodes, nnodes, SYNC_ONE_TO_ALL);
 	}
 
-	KASSERT((_syncout >= 0) && (_syncin >= 0));
+	KASSERT((g->syncout >= 0) && (g->syncin >= 0));
 }
 
 /**
- * @brief Barrier function.
+ * @brief Waits in a barrier group.
+ *
+ * @param g Target group.
  */
-void barrier_nodes(void)
+void barrier_group_wait(struct barrier_group *g)
 {
-	if (_node_is_master)
+	if (g->is_master)
 	{
-		ksync_wait(_syncin);
-		ksync_signal(_syncout);
+		ksync_wait(g->syncin);
+		ksync_signal(g->syncout);
 	}
 	else
 	{
-		ksync_signal(_syncout);
-		ksync_wait(_syncin);
+		ksync_signal(g->syncout);
+		ksync_wait(g->syncin);
+	}
+}
+
+/**
+ * @brief Cleans up a barrier group.
+ *
+ * @param g Target group.
+ */
+void barrier_group_cleanup(struct barrier_group *g)
+{
+	ksync_unlink(g->syncin);
+	ksync_close(g->syncout);
+
+	g->syncin    = -1;
+	g->syncout   = -1;
+	g->is_master = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ * Nodes: Hierarchical Barriers                                               *
+ *----------------------------------------------------------------------------*/
+
+/**
+ * @brief Fan-in of the combining tree of nodes.
+ */
+#ifndef BARRIER_NODES_ARITY
+#define BARRIER_NODES_ARITY 4
+#endif
+
+static int _nodes_algorithm = BARRIER_NODES_FLAT;
+static struct node_barrier _barrier;
+
+/**
+ * @brief Names of barrier algorithms of nodes.
+ */
+const char *barrier_nodes_names[BARRIER_NODES_NUM] = {
+	"flat", "tree"
+};
+
+/**
+ * @brief Gets the index of the local node.
+ *
+ * @param nodes  Nodes in the barrier.
+ * @param nnodes Number of nodes in the barrier.
+ */
+PRIVATE int node_index(const int * nodes, int nnodes)
+{
+	int nodenum = knode_get_num();
+
+	for (int i = 0; i < nnodes; i++)
+	{
+		if (nodes[i] == nodenum)
+			return (i);
+	}
+
+	KASSERT(0);
+
+	return (-1);
+}
+
+/**
+ * @brief Gets a node of the combining tree and its children.
+ *
+ * @param nodes  Nodes in the barrier.
+ * @param nnodes Number of nodes in the barrier.
+ * @param i      Index of the target node.
+ * @param group  Where to store the group (node first).
+ *
+ * @returns The number of nodes in the group.
+ */
+PRIVATE int tree_group(const int * nodes, int nnodes, int i, int *group)
+{
+	int n = 0;
+
+	group[n++] = nodes[i];
+
+	for (int c = BARRIER_NODES_ARITY*i + 1; c <= BARRIER_NODES_ARITY*(i + 1); c++)
+	{
+		if (c < nnodes)
+			group[n++] = nodes[c];
+	}
+
+	return (n);
+}
+
+/**
+ * @brief Sets up a barrier of nodes.
+ *
+ * @param b         Target barrier.
+ * @param algorithm Barrier algorithm.
+ * @param nodes     Nodes in the barrier (master first).
+ * @param nnodes    Number of nodes in the barrier.
+ * @param is_master Is the local node the master of the barrier?
+ *
+ * @details In the combining tree, each node leads a group with its
+ * children and joins the group led by its parent, so no node waits
+ * for more than BARRIER_NODES_ARITY others.
+ */
+void node_barrier_setup(struct node_barrier *b, int algorithm, const int * nodes, int nnodes, int is_master)
+{
+	int n;
+	int index;
+	int group[BARRIER_NODES_ARITY + 1];
+
+	KASSERT((b != NULL) && (nodes != NULL) && (nnodes > 0));
+	KASSERT((algorithm >= 0) && (algorithm < BARRIER_NODES_NUM));
+
+	b->algorithm = algorithm;
+
+	if (algorithm == BARRIER_NODES_FLAT)
+	{
+		barrier_group_setup(&b->down, nodes, nnodes, is_master);
+		return;
+	}
+
+	index = node_index(nodes, nnodes);
+	KASSERT((index == 0) == (is_master != 0));
+
+	n = tree_group(nodes, nnodes, index, group);
+	b->has_children = (n > 1);
+	if (b->has_children)
+		barrier_group_setup(&b->down, group, n, 1);
+
+	b->has_parent = (index > 0);
+	if (b->has_parent)
+	{
+		n = tree_group(nodes, nnodes, (index - 1)/BARRIER_NODES_ARITY, group);
+		barrier_group_setup(&b->up, group, n, 0);
+	}
+}
+
+/**
+ * @brief Waits in a barrier of nodes.
+ *
+ * @param b Target barrier.
+ */
+void node_barrier_wait(struct node_barrier *b)
+{
+	if (b->algorithm == BARRIER_NODES_FLAT)
+	{
+		barrier_group_wait(&b->down);
+		return;
+	}
+
+	/* Gathers children. */
+	if (b->has_children)
+		ksync_wait(b->down.syncin);
+
+	/* Arrives at the parent and waits for it. */
+	if (b->has_parent)
+		barrier_group_wait(&b->up);
+
+	/* Releases children. */
+	if (b->has_children)
+		ksync_signal(b->down.syncout);
+}
+
+/**
+ * @brief Cleans up a barrier of nodes.
+ *
+ * @param b Target barrier.
+ */
+void node_barrier_cleanup(struct node_barrier *b)
+{
+	if (b->algorithm == BARRIER_NODES_FLAT)
+	{
+		barrier_group_cleanup(&b->down);
+		return;
 	}
+
+	if (b->has_children)
+		barrier_group_cleanup(&b->down);
+	if (b->has_parent)
+		barrier_group_cleanup(&b->up);
+}
+
+/**
+ * @brief Selects the barrier algorithm of nodes.
+ *
+ * @param algorithm Target algorithm.
+ *
+ * @details Call it before barrier_nodes_setup().
+ */
+void barrier_nodes_select(int algorithm)
+{
+	KASSERT((algorithm >= 0) && (algorithm < BARRIER_NODES_NUM));
+
+	_nodes_algorithm = algorithm;
+}
+
+/**
+ * @brief Barrier setup function.
+ */
+void barrier_nodes_setup(const int * nodes, int nnodes, int is_master)
+{
+	node_barrier_setup(&_barrier, _nodes_algorithm, nodes, nnodes, is_master);
+}
+
+/**
+ * @brief Barrier function.
+ */
+void barrier_nodes(void)
+{
+	node_barrier_wait(&_barrier);
 }
 
 /**
@@ -82,12 +290,7 @@ void barrier_nodes(void)
  */
 void barrier_nodes_cleanup(void)
 {
-	ksync_unlink(_syncin);
-	ksync_close(_syncout);
-
-	_syncin    = -1;
-	_syncout   = -1;
-	_node_is_master = 0;
+	node_barrier_cleanup(&_barrier);
 }
 
 #endif /* __TARGET_HAS_SYNC */
@@ -110,6 +313,7 @@ struct fence
 static volatile int _exit  = 0;
 static spinlock_t _lock    = SPINLOCK_UNLOCKED;
 static struct fence _fence = { 0, 0, 0, SPINLOCK_UNLOCKED };
+static struct fence _hfence = { 0, 0, 0, SPINLOCK_UNLOCKED };
 
 /**
  * @brief Initializes a fence.
@@ -160,6 +364,271 @@ PRIVATE void fence(struct fence *b)
 	}
 }
 
+/*----------------------------------------------------------------------------*
+ * Cores: Scalable Barriers                                                   *
+ *----------------------------------------------------------------------------*/
+
+/**
+ * @brief Maximum number of rounds of a barrier.
+ */
+#define BARRIER_ROUNDS_MAX 8
+
+/**
+ * @brief Fan-in of the combining tree.
+ */
+#define BARRIER_TREE_ARITY 4
+
+/**
+ * @brief Local state of a core.
+ */
+struct core_local
+{
+	kthread_t tid;                             /**< Thread.               */
+	int sense;                                 /**< Local sense.          */
+	int hsense;                                /**< Local hybrid sense.   */
+	int parity;                                /**< Dissemination parity. */
+	int volatile flags[2][BARRIER_ROUNDS_MAX]; /**< Flags set by others.  */
+} ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Node of the combining tree.
+ */
+struct tree_node
+{
+	int volatile count;       /**< Children yet to arrive. */
+	int volatile sense;       /**< Release of children.    */
+	int k;                    /**< Number of children.     */
+	struct tree_node *parent; /**< Parent node.            */
+} ALIGN(CACHE_LINE_SIZE);
+
+static int _algorithm = BARRIER_CORES_CENTRAL;
+static int _ncores    = 0;
+static int _nrounds   = 0;
+
+static struct core_local _locals[THREAD_MAX];
+static struct tree_node _nodes[2*THREAD_MAX];
+
+static int volatile _count ALIGN(CACHE_LINE_SIZE) = 0;
+static int volatile _sense ALIGN(CACHE_LINE_SIZE) = 0;
+
+static int volatile _hcount ALIGN(CACHE_LINE_SIZE) = 0;
+static int volatile _hsense ALIGN(CACHE_LINE_SIZE) = 0;
+
+/**
+ * @brief Names of barrier algorithms.
+ */
+const char *barrier_cores_names[BARRIER_CORES_NUM] = {
+	"central", "sense", "tree", "dissemination", "tournament"
+};
+
+/**
+ * @brief Gets the index of the calling core.
+ *
+ * @details This issues a kernel call and scans all cores, so callers
+ * that know their index should pass it to barrier_cores_wait().
+ */
+PRIVATE int core_index(void)
+{
+	kthread_t tid = kthread_self();
+
+	for (int i = 0; i < _ncores; i++)
+	{
+		if (_locals[i].tid == tid)
+			return (i);
+	}
+
+	KASSERT(0);
+
+	return (-1);
+}
+
+/**
+ * @brief Resets the state of scalable barriers.
+ *
+ * @param ncores Number of cores in the barrier.
+ */
+PRIVATE void scalable_init(int ncores)
+{
+	int n;
+	int first;
+	int last;
+
+	_ncores = ncores;
+	_count  = ncores;
+	_sense  = 0;
+	_hcount = ncores;
+	_hsense = 0;
+
+	for (_nrounds = 0; (1 << _nrounds) < ncores; _nrounds++)
+		/* noop */;
+
+	KASSERT(_nrounds <= BARRIER_ROUNDS_MAX);
+
+	for (int i = 0; i < ncores; i++)
+	{
+		_locals[i].sense  = 0;
+		_locals[i].hsense = 0;
+		_locals[i].parity = 0;
+		for (int r = 0; r < BARRIER_ROUNDS_MAX; r++)
+		{
+			_locals[i].flags[0][r] = 0;
+			_locals[i].flags[1][r] = 0;
+		}
+	}
+
+	/* Build the combining tree, leaves first. */
+	n     = ncores;
+	first = 0;
+	last  = 0;
+	do
+	{
+		int m = (n + BARRIER_TREE_ARITY - 1)/BARRIER_TREE_ARITY;
+
+		for (int i = 0; i < m; i++)
+		{
+			struct tree_node *node = &_nodes[last + i];
+
+			node->k      = ((i + 1)*BARRIER_TREE_ARITY <= n) ?
+				BARRIER_TREE_ARITY : n - i*BARRIER_TREE_ARITY;
+			node->count  = node->k;
+			node->sense  = 0;
+			node->parent = NULL;
+		}
+
+		/* Link nodes of the previous level. */
+		if (last > 0)
+		{
+			for (int i = first; i < last; i++)
+				_nodes[i].parent = &_nodes[last + (i - first)/BARRIER_TREE_ARITY];
+		}
+
+		first = last;
+		last += m;
+		n = m;
+	} while (n > 1);
+}
+
+/**
+ * @brief Sense-reversing barrier.
+ *
+ * @details Waiters spin on the shared sense word, not on a flag of
+ * their own, so a release invalidates the line in every waiter.
+ */
+PRIVATE void barrier_sense(struct core_local *self)
+{
+	int sense = self->sense = !self->sense;
+
+	if (__sync_sub_and_fetch(&_count, 1) == 0)
+	{
+		_count = _ncores;
+		__sync_synchronize();
+		_sense = sense;
+	}
+	else
+	{
+		while (_sense != sense)
+			/* noop */;
+	}
+}
+
+/**
+ * @brief Arrives at a node of the combining tree.
+ */
+PRIVATE void tree_arrive(struct tree_node *node, int sense)
+{
+	if (__sync_sub_and_fetch(&node->count, 1) == 0)
+	{
+		if (node->parent != NULL)
+			tree_arrive(node->parent, sense);
+
+		node->count = node->k;
+		__sync_synchronize();
+		node->sense = sense;
+	}
+	else
+	{
+		while (node->sense != sense)
+			/* noop */;
+	}
+}
+
+/**
+ * @brief Combining tree barrier.
+ */
+PRIVATE void barrier_tree(struct core_local *self)
+{
+	int sense = self->sense = !self->sense;
+
+	tree_arrive(&_nodes[(self - _locals)/BARRIER_TREE_ARITY], sense);
+}
+
+/**
+ * @brief Dissemination barrier.
+ */
+PRIVATE void barrier_dissemination(struct core_local *self)
+{
+	int me = self - _locals;
+
+	for (int r = 0; r < _nrounds; r++)
+	{
+		struct core_local *partner = &_locals[(me + (1 << r))%_ncores];
+
+		partner->flags[self->parity][r] = !self->sense;
+		while (self->flags[self->parity][r] == self->sense)
+			/* noop */;
+	}
+
+	if (self->parity == 1)
+		self->sense = !self->sense;
+	self->parity = 1 - self->parity;
+}
+
+/**
+ * @brief Tournament barrier.
+ */
+PRIVATE void barrier_tournament(struct core_local *self)
+{
+	int me = self - _locals;
+	int sense = self->sense = !self->sense;
+
+	for (int r = 0; r < _nrounds; r++)
+	{
+		/* Loser: tell the winner and wait for the champion. */
+		if (me & (1 << r))
+		{
+			_locals[me - (1 << r)].flags[0][r] = sense;
+			while (_sense != sense)
+				/* noop */;
+			return;
+		}
+
+		/* Winner: wait for the loser, if any. */
+		if ((me + (1 << r)) < _ncores)
+		{
+			while (self->flags[0][r] != sense)
+				/* noop */;
+		}
+	}
+
+	/* Champion. */
+	__sync_synchronize();
+	_sense = sense;
+}
+
+/**
+ * @brief Selects the barrier algorithm of cores.
+ *
+ * @param algorithm Target algorithm.
+ *
+ * @details Call it before barrier_cores_setup().
+ */
+void barrier_cores_select(int algorithm)
+{
+	KASSERT((algorithm >= 0) && (algorithm < BARRIER_CORES_AVAILABLE));
+
+	_algorithm = algorithm;
+}
+
 /**
  * @brief Barrier setup function.
  */
@@ -168,10 +637,14 @@ void barrier_cores_setup(int tid, int ncores)
 	int try;
 	int exit;
 
+	_locals[tid].tid = kthread_self();
+
 	if (tid == 0)
 	{
 		spinlock_lock(&_lock);
 			fence_init(&_fence, ncores);
+			fence_init(&_hfence, ncores);
+			scalable_init(ncores);
 			_exit = 1;
 		spinlock_unlock(&_lock);
 	}
@@ -195,10 +668,46 @@ void barrier_cores_setup(int tid, int ncores)
 
 /**
  * @brief Barrier function.
+ *
+ * @param tid ID of the calling thread, as given to barrier_cores_setup().
+ */
+void barrier_cores_wait(int tid)
+{
+	switch (_algorithm)
+	{
+		case BARRIER_CORES_SENSE:
+			barrier_sense(&_locals[tid]);
+			break;
+
+		case BARRIER_CORES_TREE:
+			barrier_tree(&_locals[tid]);
+			break;
+
+		case BARRIER_CORES_DISSEMINATION:
+			barrier_dissemination(&_locals[tid]);
+			break;
+
+		case BARRIER_CORES_TOURNAMENT:
+			barrier_tournament(&_locals[tid]);
+			break;
+
+		default:
+			fence(&_fence);
+			break;
+	}
+}
+
+/**
+ * @brief Barrier function.
+ *
+ * @details Scalable algorithms look up the calling thread first.
  */
 void barrier_cores(void)
 {
-	fence(&_fence);
+	if (_algorithm == BARRIER_CORES_CENTRAL)
+		fence(&_fence);
+	else
+		barrier_cores_wait(core_index());
 }
 
 /**
@@ -211,3 +720,80 @@ void barrier_cores_cleanup(int tid)
 
 	fence(&_fence);	
 }
+
+#if (__TARGET_HAS_SYNC)
+
+/*----------------------------------------------------------------------------*
+ * Nodes and Cores                                                            *
+ *----------------------------------------------------------------------------*/
+
+/**
+ * @brief Barrier of all threads in all nodes.
+ *
+ * @param tid ID of the calling thread, as given to barrier_cores_setup().
+ *
+ * @details Threads of a node combine as in BARRIER_CORES_HYBRID, and
+ * the last one to arrive represents the node in the barrier of nodes
+ * before releasing the others. Both barrier_nodes_setup() and
+ * barrier_cores_setup() should have been called.
+ */
+void barrier_hybrid(int tid)
+{
+#if (BARRIER_CORES_HYBRID == BARRIER_CORES_SENSE)
+
+	struct core_local *self = &_locals[tid];
+	int sense = self->hsense = !self->hsense;
+
+	if (__sync_sub_and_fetch(&_hcount, 1) == 0)
+	{
+		barrier_nodes();
+
+		_hcount = _ncores;
+		__sync_synchronize();
+		_hsense = sense;
+	}
+	else
+	{
+		while (_hsense != sense)
+			/* noop */;
+	}
+
+#else
+
+	int last;
+	int exit;
+	int local_release;
+
+	UNUSED(tid);
+
+	spinlock_lock(&_hfence.lock);
+
+		local_release = !_hfence.release;
+		last = (++_hfence.nreached == _hfence.ncores);
+
+	spinlock_unlock(&_hfence.lock);
+
+	if (last)
+	{
+		barrier_nodes();
+
+		spinlock_lock(&_hfence.lock);
+			_hfence.nreached = 0;
+			_hfence.release  = local_release;
+		spinlock_unlock(&_hfence.lock);
+	}
+	else
+	{
+		exit = 0;
+		while (!exit)
+		{
+			spinlock_lock(&_hfence.lock);
+				exit = (local_release == _hfence.release);
+			spinlock_unlock(&_hfence.lock);
+		}
+	}
+
+#endif
+}
+
+#endif /* __TARGET_HAS_SYNC */
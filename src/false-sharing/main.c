@@ -0,0 +1,350 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include <nanvix/ulib.h>
+#include <posix/stdint.h>
+#include <kbench.h>
+#include "../comm/comm.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP               1  /**< Increment on Number of Working Threads */
+#define NUPDATES            (1 << 16)  /**< Updates per Thread                     */
+/**@}*/
+
+/**
+ * @brief Maximum number of threads whose counters fit in a line.
+ */
+#define NTHREADS_SAME_LINE \
+	((((int) (CACHE_LINE_SIZE/WORD_SIZE)) < NTHREADS_MAX) ? ((int) (CACHE_LINE_SIZE/WORD_SIZE)) : NTHREADS_MAX)
+
+/**
+ * @brief Horizontal line.
+ */
+const char *HLINE =
+	"------------------------------------------------------------------------";
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS;       /**< Number of Working Threads */
+static const char *LAYOUT; /**< Counter Layout            */
+static const char *STORE;  /**< Store Kind                */
+/**@}*/
+
+/*============================================================================*
+ * Profiling                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "false-sharing"
+
+/**
+ * @brief Number of events to profile.
+ */
+#if defined(__mppa256__)
+	#define BENCHMARK_PERF_EVENTS 7
+#elif defined(__optimsoc__)
+	#define BENCHMARK_PERF_EVENTS 7
+#else
+	#define BENCHMARK_PERF_EVENTS 1
+#endif
+
+/**
+ * Performance events.
+ */
+static int perf_events[BENCHMARK_PERF_EVENTS] = {
+#if defined(__mppa256__)
+	PERF_DTLB_STALLS,
+	PERF_ITLB_STALLS,
+	PERF_REG_STALLS,
+	PERF_BRANCH_STALLS,
+	PERF_DCACHE_STALLS,
+	PERF_ICACHE_STALLS,
+	PERF_CYCLES
+#elif defined(__optimsoc__)
+	MOR1KX_PERF_LSU_HITS,
+	MOR1KX_PERF_BRANCH_STALLS,
+	MOR1KX_PERF_ICACHE_HITS,
+	MOR1KX_PERF_REG_STALLS,
+	MOR1KX_PERF_ICACHE_MISSES,
+	MOR1KX_PERF_IFETCH_STALLS,
+	MOR1KX_PERF_LSU_STALLS,
+#else
+	0
+#endif
+};
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param cycles Time for all threads to update their counters (in cycles).
+ * @param stats  Execution statistics of the master thread.
+ */
+static void benchmark_dump_stats(int it, const char *name, uint64_t cycles, uint64_t *stats)
+{
+	uprintf(
+#if defined(__mppa256__)
+		"[benchmarks][%s] %d %s %s %d %d %d %d %d %d %d %d %d %d",
+#elif defined(__optimsoc__)
+		"[benchmarks][%s] %d %s %s %d %d %d %d %d %d %d %d %d %d",
+#else
+		"[benchmarks][%s] %d %s %s %d %d %d %d",
+#endif
+		name,
+		it,
+		LAYOUT,
+		STORE,
+		NTHREADS,
+		UINT32(cycles),
+		UINT32(cycles_to_rate(NTHREADS*NUPDATES, cycles)),
+#if defined(__mppa256__) || defined(__optimsoc__)
+		UINT32(stats[0]),
+		UINT32(stats[1]),
+		UINT32(stats[2]),
+		UINT32(stats[3]),
+		UINT32(stats[4]),
+		UINT32(stats[5]),
+		UINT32(stats[6])
+#else
+		UINT32(stats[0])
+#endif
+	);
+}
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Counter layouts.
+ *
+ * @details Counters of consecutive threads lie stride bytes apart. The
+ * same-line layout runs only as many threads as counters fit in a
+ * line. The padded layout also keeps them off adjacent lines, which
+ * some caches fetch in pairs.
+ */
+static const struct layout
+{
+	const char *name; /**< Layout Name               */
+	size_t stride;    /**< Counter Stride (bytes)    */
+	int nthreads_max; /**< Maximum Number of Threads */
+} layouts[] = {
+	{ "same-line", WORD_SIZE,         NTHREADS_SAME_LINE },
+	{ "adjacent",  CACHE_LINE_SIZE,   NTHREADS_MAX       },
+	{ "padded",    2*CACHE_LINE_SIZE, NTHREADS_MAX       },
+};
+
+/**
+ * @brief Number of counter layouts.
+ */
+#define NLAYOUTS ((int) (sizeof(layouts)/sizeof(layouts[0])))
+
+/**
+ * @brief Increments a counter with plain stores.
+ */
+static void update_plain(volatile word_t *counter)
+{
+	for (int i = 0; i < NUPDATES; i++)
+		*counter = *counter + 1;
+}
+
+/**
+ * @brief Increments a counter with atomic read-modify-writes.
+ */
+static void update_atomic(volatile word_t *counter)
+{
+	for (int i = 0; i < NUPDATES; i++)
+		__sync_fetch_and_add(counter, 1);
+}
+
+/**
+ * @brief Store kinds.
+ */
+static const struct store
+{
+	const char *name;                  /**< Store Name      */
+	void (*update)(volatile word_t *); /**< Update Function */
+} stores[] = {
+	{ "plain",  update_plain  },
+	{ "atomic", update_atomic },
+};
+
+/**
+ * @brief Number of store kinds.
+ */
+#define NSTORES ((int) (sizeof(stores)/sizeof(stores[0])))
+
+/**
+ * @brief Counters.
+ */
+static word_t counters[NTHREADS_MAX*2*CACHE_LINE_SIZE/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tnum;                 /**< Thread Number */
+	volatile word_t *counter; /**< Own Counter   */
+	const struct store *s;    /**< Store Kind    */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Updates the counter of a thread.
+ *
+ * @details Threads synchronize around each round, so that the master
+ * times all of them updating their counters at once.
+ */
+static void *task(void *arg)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	struct tdata *t = arg;
+	uint64_t stats[BENCHMARK_PERF_EVENTS];
+
+	barrier_cores_setup(t->tnum, NTHREADS);
+
+	for (int i = 0; i < NITERATIONS + SKIP; i++)
+	{
+		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+		{
+			barrier_cores();
+			if (t->tnum == 0)
+				kclock(&t0);
+
+			perf_start(0, perf_events[j]);
+
+				t->s->update(t->counter);
+
+			perf_stop(0);
+			stats[j] = perf_read(0);
+
+			barrier_cores();
+			if (t->tnum == 0)
+				kclock(&t1);
+		}
+
+		if ((i >= SKIP) && (t->tnum == 0))
+			benchmark_dump_stats(i - SKIP, BENCHMARK_NAME, t1 - t0, stats);
+	}
+
+	barrier_cores_cleanup(t->tnum);
+
+	return (NULL);
+}
+
+/**
+ * @brief False Sharing Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ * @param l        Counter layout.
+ * @param s        Store kind.
+ */
+static void kernel_false_sharing(int nthreads, const struct layout *l, const struct store *s)
+{
+	kthread_t tid[NTHREADS_MAX];
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+	LAYOUT = l->name;
+	STORE = s->name;
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		tdata[i].tnum = i;
+		tdata[i].counter = (volatile word_t *) ((char *) counters + i*l->stride);
+		tdata[i].s = s;
+
+		*tdata[i].counter = 0;
+
+		kthread_create(&tid[i], task, &tdata[i]);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_join(tid[i], NULL);
+}
+
+#endif
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief False Sharing Benchmark
+ *
+ * @param argc Argument counter.
+ * @param argv Argument variables.
+ */
+int __main2(int argc, const char *argv[])
+{
+	((void) argc);
+	((void) argv);
+
+#ifndef __qemu_riscv32__
+
+	uprintf(HLINE);
+
+#ifndef NDEBUG
+
+	for (int i = 0; i < NLAYOUTS; i++)
+	{
+		for (int j = 0; j < NSTORES; j++)
+			kernel_false_sharing(layouts[i].nthreads_max, &layouts[i], &stores[j]);
+	}
+
+#else
+
+	for (int i = 0; i < NLAYOUTS; i++)
+	{
+		for (int j = 0; j < NSTORES; j++)
+		{
+			for (int nthreads = NTHREADS_MIN; nthreads <= layouts[i].nthreads_max; nthreads += NTHREADS_STEP)
+				kernel_false_sharing(nthreads, &layouts[i], &stores[j]);
+		}
+	}
+
+#endif
+
+	uprintf(HLINE);
+
+#endif
+
+	return (0);
+}
@@ -0,0 +1,205 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../comm/comm.h"
+#include "noise.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "noise"
+
+/*============================================================================*
+ * Bulk-Synchronous Benchmark                                                 *
+ *============================================================================*/
+
+/**
+ * @brief Compute time of each worker in each phase.
+ */
+static uint32_t computes[NTHREADS_MAX][BSP_NPHASES];
+
+/**
+ * @brief Length of each phase, from barrier to barrier.
+ */
+static uint64_t phases[BSP_NPHASES];
+
+/**
+ * @brief Slowdown of each phase (in permille of the ideal one).
+ */
+static uint64_t slowdowns[BSP_NPHASES];
+
+/**
+ * @brief Worker info.
+ */
+static struct bdata
+{
+	int tid;        /**< Thread ID        */
+	int nworkers;   /**< Number of Peers  */
+	float scratch;  /**< Scratch Variable */
+} bdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Computes in phases separated by barriers.
+ */
+static void *task_bsp(void *arg)
+{
+	uint64_t t0;
+	uint64_t t1;
+	uint64_t last;
+	uint64_t now;
+	struct bdata *t = arg;
+	float tmp = t->scratch;
+
+	barrier_cores_setup(t->tid, t->nworkers);
+
+	kclock(&last);
+
+	for (int p = 0; p < BSP_NPHASES; p++)
+	{
+		kclock(&t0);
+			tmp = do_flops(tmp, BSP_FLOPS);
+		kclock(&t1);
+
+		barrier_cores();
+
+		computes[t->tid][p] = UINT32(t1 - t0);
+
+		/* The master keeps track of the phase length. */
+		if (t->tid == 0)
+		{
+			kclock(&now);
+			phases[p] = now - last;
+			last = now;
+		}
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	/* Avoid compiler optimizations. */
+	t->scratch = tmp;
+
+	return (NULL);
+}
+
+/**
+ * @brief Dump results of the bulk-synchronous benchmark.
+ *
+ * @param name     Benchmark name.
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ *
+ * @details The ideal phase is the fastest compute time seen in the
+ * run. The max-of-N effect is the mean of the slowest worker of each
+ * phase over the mean of all workers, and the slowdown distribution
+ * compares phase lengths against the ideal phase.
+ */
+static void benchmark_dump_bsp(
+	const char *name,
+	const struct noise_generator *gen,
+	int duty,
+	int nworkers,
+	int nidle
+)
+{
+	uint64_t ideal = ~0ULL;
+	uint64_t sum = 0;
+	uint64_t sum_max = 0;
+	uint64_t sum_phase = 0;
+
+	for (int p = 0; p < BSP_NPHASES; p++)
+	{
+		uint64_t max = 0;
+
+		for (int i = 0; i < nworkers; i++)
+		{
+			if (computes[i][p] < ideal)
+				ideal = computes[i][p];
+			if (computes[i][p] > max)
+				max = computes[i][p];
+			sum += computes[i][p];
+		}
+
+		sum_max += max;
+		sum_phase += phases[p];
+	}
+
+	for (int p = 0; p < BSP_NPHASES; p++)
+		slowdowns[p] = (phases[p]*1000)/ideal;
+
+	samples_sort(slowdowns, BSP_NPHASES);
+
+	uprintf("[benchmarks][%s][bsp] %s %d %d %d %d %d %d %d %d %d %d %d %d",
+		name,
+		noise_name(gen),
+		duty,
+		nworkers,
+		nidle,
+		BSP_NPHASES,
+		UINT32(ideal),
+		UINT32(sum/(nworkers*BSP_NPHASES)),
+		UINT32(sum_max/BSP_NPHASES),
+		UINT32(sum_phase/BSP_NPHASES),
+		UINT32((sum_max*nworkers*1000)/sum),
+		UINT32(samples_percentile(slowdowns, BSP_NPHASES, 500)),
+		UINT32(samples_percentile(slowdowns, BSP_NPHASES, 990)),
+		UINT32(slowdowns[BSP_NPHASES - 1])
+	);
+}
+
+/**
+ * @brief Bulk-Synchronous Benchmark
+ *
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ */
+void benchmark_bsp(const struct noise_generator *gen, int duty, int nworkers, int nidle)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	/* Spawn noise threads first, so that we have a noisy system. */
+	noise_spawn(gen, duty, nidle);
+
+	for (int i = 0; i < nworkers; i++)
+	{
+		bdata[i].tid = i;
+		bdata[i].nworkers = nworkers;
+		bdata[i].scratch = 0.0;
+		kthread_create(&tids[i], task_bsp, &bdata[i]);
+	}
+
+	for (int i = 0; i < nworkers; i++)
+		kthread_join(tids[i], NULL);
+
+	noise_join();
+
+	benchmark_dump_bsp(BENCHMARK_NAME, gen, duty, nworkers, nidle);
+}
+
+#endif
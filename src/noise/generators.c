@@ -0,0 +1,425 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/semaphore.h>
+#include <nanvix/sys/mailbox.h>
+#include <nanvix/sys/portal.h>
+#include <nanvix/sys/page.h>
+#include "noise.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Does nothing.
+ */
+static void noise_nop(int id)
+{
+	UNUSED(id);
+}
+
+/**
+ * @brief Sets up nothing.
+ */
+static void noise_nosetup(int ninstances)
+{
+	UNUSED(ninstances);
+}
+
+/*============================================================================*
+ * Remote Kernel Calls                                                        *
+ *============================================================================*/
+
+/**
+ * @brief Issues a remote kernel call.
+ */
+static void kcall_burst(int id)
+{
+	UNUSED(id);
+
+	kcall0(NR_SYSCALLS);
+}
+
+/**
+ * @brief Remote kernel call generator.
+ */
+static const struct noise_generator noise_kcall = {
+	.name   = "kcall",
+	.nslots = 1,
+	.setup  = noise_nosetup,
+	.burst  = kcall_burst,
+	.serve  = NULL,
+	.stop   = noise_nop,
+};
+
+/*============================================================================*
+ * Page Allocations                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Maps, touches and unmaps a page.
+ *
+ * @details There is no demand paging, so this is the closest we get to
+ * page faults: page table updates and TLB shootdowns in the kernel.
+ */
+static void page_burst(int id)
+{
+	vaddr_t vaddr = KBENCH_SCRATCH_VIRT + id*PAGE_SIZE;
+
+	KASSERT(page_alloc(vaddr) == 0);
+		*((volatile word_t *) vaddr) = (word_t) id;
+	KASSERT(page_free(vaddr) == 0);
+}
+
+/**
+ * @brief Page allocation generator.
+ */
+static const struct noise_generator noise_page = {
+	.name   = "page",
+	.nslots = 1,
+	.setup  = noise_nosetup,
+	.burst  = page_burst,
+	.serve  = NULL,
+	.stop   = noise_nop,
+};
+
+/*============================================================================*
+ * Mailbox Traffic                                                            *
+ *============================================================================*/
+
+/**
+ * @brief Mailboxes.
+ */
+static struct
+{
+	int inbox;                           /**< Input Mailbox  */
+	int outbox;                          /**< Output Mailbox */
+	char message[KMAILBOX_MESSAGE_SIZE]; /**< Message Buffer */
+} mailboxes[NTHREADS_MAX];
+
+/**
+ * @brief Opens loopback mailboxes.
+ */
+static void mailbox_setup(int ninstances)
+{
+	int local = knode_get_num();
+
+	for (int i = 0; i < ninstances; i++)
+	{
+		KASSERT((mailboxes[i].inbox = kmailbox_create(local, i)) >= 0);
+		KASSERT((mailboxes[i].outbox = kmailbox_open(local, i)) >= 0);
+	}
+}
+
+/**
+ * @brief Sends a message to itself.
+ */
+static void mailbox_burst(int id)
+{
+	KASSERT(kmailbox_write(mailboxes[id].outbox, mailboxes[id].message, KMAILBOX_MESSAGE_SIZE) == KMAILBOX_MESSAGE_SIZE);
+	KASSERT(kmailbox_read(mailboxes[id].inbox, mailboxes[id].message, KMAILBOX_MESSAGE_SIZE) == KMAILBOX_MESSAGE_SIZE);
+}
+
+/**
+ * @brief Closes loopback mailboxes.
+ */
+static void mailbox_stop(int id)
+{
+	KASSERT(kmailbox_close(mailboxes[id].outbox) == 0);
+	KASSERT(kmailbox_unlink(mailboxes[id].inbox) == 0);
+}
+
+/**
+ * @brief Mailbox traffic generator.
+ */
+static const struct noise_generator noise_mailbox = {
+	.name   = "mailbox",
+	.nslots = 1,
+	.setup  = mailbox_setup,
+	.burst  = mailbox_burst,
+	.serve  = NULL,
+	.stop   = mailbox_stop,
+};
+
+/*============================================================================*
+ * Portal Traffic                                                             *
+ *============================================================================*/
+
+/**
+ * @brief Portals.
+ *
+ * @details The first word of a message tells whether the writer is
+ * done, so that the reader never blocks on a message that is not
+ * coming.
+ */
+static struct
+{
+	int inportal;                            /**< Input Portal  */
+	int outportal;                           /**< Output Portal */
+	word_t out[NOISE_PORTAL_SIZE/WORD_SIZE]; /**< Output Buffer */
+	word_t in[NOISE_PORTAL_SIZE/WORD_SIZE];  /**< Input Buffer  */
+} portals[NTHREADS_MAX/2];
+
+/**
+ * @brief Opens loopback portals.
+ */
+static void portal_setup(int ninstances)
+{
+	int local = knode_get_num();
+
+	for (int i = 0; i < ninstances; i++)
+	{
+		KASSERT((portals[i].inportal = kportal_create(local, i)) >= 0);
+		KASSERT((portals[i].outportal = kportal_open(local, local, i)) >= 0);
+		portals[i].out[0] = 0;
+	}
+}
+
+/**
+ * @brief Sends a message to the partner thread.
+ */
+static void portal_burst(int id)
+{
+	KASSERT(kportal_write(portals[id].outportal, portals[id].out, NOISE_PORTAL_SIZE) == NOISE_PORTAL_SIZE);
+}
+
+/**
+ * @brief Receives messages until the writer is done.
+ */
+static void portal_serve(int id)
+{
+	int local = knode_get_num();
+
+	do
+	{
+		KASSERT(kportal_allow(portals[id].inportal, local, id) == 0);
+		KASSERT(kportal_read(portals[id].inportal, portals[id].in, NOISE_PORTAL_SIZE) == NOISE_PORTAL_SIZE);
+	} while (portals[id].in[0] == 0);
+
+	KASSERT(kportal_unlink(portals[id].inportal) == 0);
+}
+
+/**
+ * @brief Tells the partner thread to stop and closes the portal.
+ */
+static void portal_stop(int id)
+{
+	portals[id].out[0] = 1;
+	portal_burst(id);
+
+	KASSERT(kportal_close(portals[id].outportal) == 0);
+}
+
+/**
+ * @brief Portal traffic generator.
+ */
+static const struct noise_generator noise_portal = {
+	.name   = "portal",
+	.nslots = 2,
+	.setup  = portal_setup,
+	.burst  = portal_burst,
+	.serve  = portal_serve,
+	.stop   = portal_stop,
+};
+
+/*============================================================================*
+ * Thread Churn                                                               *
+ *============================================================================*/
+
+/**
+ * @brief Does nothing.
+ */
+static void *task_empty(void *arg)
+{
+	return (arg);
+}
+
+/**
+ * @brief Creates and joins a thread.
+ *
+ * @details The thread takes the second slot of the instance.
+ */
+static void churn_burst(int id)
+{
+	kthread_t tid;
+
+	UNUSED(id);
+
+	KASSERT(kthread_create(&tid, task_empty, NULL) == 0);
+	KASSERT(kthread_join(tid, NULL) == 0);
+}
+
+/**
+ * @brief Thread churn generator.
+ */
+static const struct noise_generator noise_churn = {
+	.name   = "churn",
+	.nslots = 2,
+	.setup  = noise_nosetup,
+	.burst  = churn_burst,
+	.serve  = NULL,
+	.stop   = noise_nop,
+};
+
+/*============================================================================*
+ * Semaphore Ping-Pong                                                        *
+ *============================================================================*/
+
+/**
+ * @brief Semaphores.
+ */
+static struct
+{
+	int done;                     /**< Pinger Done? */
+	struct nanvix_semaphore ping; /**< Ping         */
+	struct nanvix_semaphore pong; /**< Pong         */
+} semaphores[NTHREADS_MAX/2];
+
+/**
+ * @brief Initializes semaphores.
+ */
+static void semaphore_setup(int ninstances)
+{
+	for (int i = 0; i < ninstances; i++)
+	{
+		semaphores[i].done = 0;
+		nanvix_semaphore_init(&semaphores[i].ping, 0);
+		nanvix_semaphore_init(&semaphores[i].pong, 0);
+	}
+}
+
+/**
+ * @brief Bounces a token off the partner thread.
+ */
+static void semaphore_burst(int id)
+{
+	nanvix_semaphore_up(&semaphores[id].pong);
+	nanvix_semaphore_down(&semaphores[id].ping);
+}
+
+/**
+ * @brief Bounces tokens back until the pinger is done.
+ */
+static void semaphore_serve(int id)
+{
+	while (1)
+	{
+		nanvix_semaphore_down(&semaphores[id].pong);
+
+		if (semaphores[id].done)
+			break;
+
+		nanvix_semaphore_up(&semaphores[id].ping);
+	}
+}
+
+/**
+ * @brief Tells the partner thread to stop.
+ */
+static void semaphore_stop(int id)
+{
+	semaphores[id].done = 1;
+	nanvix_semaphore_up(&semaphores[id].pong);
+}
+
+/**
+ * @brief Semaphore ping-pong generator.
+ */
+static const struct noise_generator noise_semaphore = {
+	.name   = "semaphore",
+	.nslots = 2,
+	.setup  = semaphore_setup,
+	.burst  = semaphore_burst,
+	.serve  = semaphore_serve,
+	.stop   = semaphore_stop,
+};
+
+/*============================================================================*
+ * Memory Hog                                                                 *
+ *============================================================================*/
+
+/**
+ * @brief Memory hog buffers.
+ *
+ * @details They are shared by all instances, which makes things worse
+ * on coherent caches.
+ */
+static word_t hog_src[NOISE_HOG_SIZE/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
+static word_t hog_dst[NOISE_HOG_SIZE/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Current offset of memory hogs (in words).
+ */
+static size_t hog_offset[NTHREADS_MAX];
+
+/**
+ * @brief Resets memory hogs.
+ */
+static void memory_setup(int ninstances)
+{
+	for (int i = 0; i < ninstances; i++)
+		hog_offset[i] = 0;
+}
+
+/**
+ * @brief Copies a chunk of the memory hog buffer.
+ */
+static void memory_burst(int id)
+{
+	size_t off = hog_offset[id];
+
+	memcopy(&hog_dst[off], &hog_src[off], NOISE_HOG_CHUNK/WORD_SIZE);
+
+	hog_offset[id] = (off + NOISE_HOG_CHUNK/WORD_SIZE)%(NOISE_HOG_SIZE/WORD_SIZE);
+}
+
+/**
+ * @brief Memory bandwidth hog generator.
+ */
+static const struct noise_generator noise_memory = {
+	.name   = "memory",
+	.nslots = 1,
+	.setup  = memory_setup,
+	.burst  = memory_burst,
+	.serve  = NULL,
+	.stop   = noise_nop,
+};
+
+/*============================================================================*
+ * Noise Generators                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Noise generators.
+ */
+const struct noise_generator *noise_generators[NOISE_GENERATORS_NUM] = {
+	&noise_kcall,
+	&noise_page,
+	&noise_mailbox,
+	&noise_portal,
+	&noise_churn,
+	&noise_semaphore,
+	&noise_memory,
+};
+
+#endif
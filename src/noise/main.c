@@ -22,24 +22,10 @@
  * SOFTWARE.
  */
 
-#include <nanvix/sys/thread.h>
-#include <nanvix/ulib.h>
-#include <posix/stdint.h>
-#include <kbench.h>
+#include "noise.h"
 
 #ifndef __qemu_riscv32__
 
-/**
- * @name Benchmark Parameters
- */
-/**@{*/
-#define NTHREADS_MIN                1  /**< Minimum Number of Worker Threads      */
-#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Worker Threads      */
-#define NTHREADS_STEP               1  /**< Increment on Number of Worker Threads */
-#define FLOPS                 (10008)  /**< Number of Floating Point Operations   */
-#define NIOOPS                  (100)  /**< Number of Floating Point Operations   */
-/**@}*/
-
 /**
  * @brief Horizontal line.
  */
@@ -50,9 +36,10 @@ static const char *HLINE =
  * @name Benchmark Kernel Parameters
  */
 /**@{*/
-static int NWORKERS;      /**< Number of Worker Threads */
-static int NIDLE;         /**< Number of Idle Threads   */
-static char *NOISE = "y"; /**< Noise On?                */
+static int NWORKERS;                        /**< Number of Worker Threads */
+static int NIDLE;                           /**< Number of Idle Threads   */
+static int DUTY;                            /**< Duty Cycle of Noise (%)  */
+static const struct noise_generator *NOISE; /**< Noise Generator          */
 /**@}*/
 
 /*============================================================================*
@@ -111,15 +98,16 @@ static void benchmark_dump_stats(int it, const char *name, uint64_t *stats)
 {
 	uprintf(
 #if (BENCHMARK_PERF_EVENTS >= 7)
-		"[benchmarks][%s] %d %s %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s] %d %s %d %d %d %d %d %d %d %d %d %d",
 #elif (BENCHMARK_PERF_EVENTS >= 5)
-		"[benchmarks][%s] %d %s %d %d %d %d %d %d %d",
+		"[benchmarks][%s] %d %s %d %d %d %d %d %d %d %d",
 #else
-		"[benchmarks][%s] %d %s %d %d %d",
+		"[benchmarks][%s] %d %s %d %d %d %d",
 #endif
 		name,
 		it,
-		NOISE,
+		noise_name(NOISE),
+		DUTY,
 		NWORKERS,
 		NIDLE,
 #if (BENCHMARK_PERF_EVENTS >= 7)
@@ -187,25 +175,6 @@ static void *task_worker(void *arg)
 	return (NULL);
 }
 
-/**
- * @brief Issues some remote kernel calls.
- */
-static void *task_idle(void *arg)
-{
-	UNUSED(arg);
-
-	for (int i = 0; i < NITERATIONS + SKIP; i++)
-	{
-		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
-		{
-			for (int k = 0; k < NIOOPS; k++)
-				kcall0(NR_SYSCALLS);
-		}
-	}
-
-	return (NULL);
-}
-
 /*============================================================================*
  * Kernel Noise Benchmark                                                     *
  *============================================================================*/
@@ -213,15 +182,18 @@ static void *task_idle(void *arg)
 /**
  * @brief Kernel Noise Benchmark Kernel
  *
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
  * @param nworkers Number of worker threads.
  * @param nidle    Number of idle threads.
  */
-static void benchmark_noise(int nworkers, int nidle)
+static void benchmark_noise(const struct noise_generator *gen, int duty, int nworkers, int nidle)
 {
 	kthread_t tid_workers[NTHREADS_MAX];
-	kthread_t tid_idle[NTHREADS_MAX];
 
 	/* Save kernel parameters. */
+	NOISE = gen;
+	DUTY = duty;
 	NWORKERS = nworkers;
 	NIDLE = nidle;
 
@@ -229,8 +201,7 @@ static void benchmark_noise(int nworkers, int nidle)
 	 * Spawn idle threads first,
 	 * so that we have a noisy system.
 	 */
-	for (int i = 0; i < nidle; i++)
-		kthread_create(&tid_idle[i], task_idle, NULL);
+	noise_spawn(gen, duty, nidle);
 
 	/* Spawn worker threads. */
 	for (int i = 0; i < nworkers; i++)
@@ -242,8 +213,7 @@ static void benchmark_noise(int nworkers, int nidle)
 	/* Wait for threads. */
 	for (int i = 0; i < nworkers; i++)
 		kthread_join(tid_workers[i], NULL);
-	for (int i = 0; i < nidle; i++)
-		kthread_join(tid_idle[i], NULL);
+	noise_join();
 }
 
 #endif
@@ -269,18 +239,43 @@ int __main2(int argc, const char *argv[])
 
 #ifndef NDEBUG
 
-	benchmark_noise(NTHREADS_MAX/2, NTHREADS_MAX/2);
+	for (int i = 0; i < NOISE_GENERATORS_NUM; i++)
+	{
+		const struct noise_generator *gen = noise_generators[i];
+
+		benchmark_noise(gen, NOISE_DUTY_MAX/2, NTHREADS_MAX/2, NTHREADS_MAX/2);
+		benchmark_fwq(gen, NOISE_DUTY_MAX/2, NTHREADS_MAX/2, NTHREADS_MAX/2);
+		benchmark_ftq(gen, NOISE_DUTY_MAX/2, NTHREADS_MAX/2, NTHREADS_MAX/2);
+		benchmark_bsp(gen, NOISE_DUTY_MAX/2, NTHREADS_MAX/2, NTHREADS_MAX/2);
+	}
 
 #else
 
 	/* With noise. */
-	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
-		benchmark_noise(nthreads, NTHREADS_MAX - nthreads);
+	for (int i = 0; i < NOISE_GENERATORS_NUM; i++)
+	{
+		const struct noise_generator *gen = noise_generators[i];
+
+		for (int duty = NOISE_DUTY_MIN; duty <= NOISE_DUTY_MAX; duty += NOISE_DUTY_STEP)
+		{
+			for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+			{
+				benchmark_noise(gen, duty, nthreads, NTHREADS_MAX - nthreads);
+				benchmark_fwq(gen, duty, nthreads, NTHREADS_MAX - nthreads);
+				benchmark_ftq(gen, duty, nthreads, NTHREADS_MAX - nthreads);
+				benchmark_bsp(gen, duty, nthreads, NTHREADS_MAX - nthreads);
+			}
+		}
+	}
 
 	/* No noise. */
-	NOISE = "n";
 	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
-		benchmark_noise(nthreads, 0);
+	{
+		benchmark_noise(NULL, 0, nthreads, 0);
+		benchmark_fwq(NULL, 0, nthreads, 0);
+		benchmark_ftq(NULL, 0, nthreads, 0);
+		benchmark_bsp(NULL, 0, nthreads, 0);
+	}
 
 #endif
 
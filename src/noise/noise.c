@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "noise.h"
+
+#ifndef __qemu_riscv32__
+
+/*============================================================================*
+ * Noise Threads                                                              *
+ *============================================================================*/
+
+/**
+ * @brief Noise threads.
+ */
+static struct
+{
+	kthread_t tids[NTHREADS_MAX];      /**< IDs of Noise Threads */
+	int nthreads;                      /**< Number of Threads    */
+	int running;                       /**< Keep Going?          */
+	int duty;                          /**< Duty Cycle (%)       */
+	uint64_t nspins;                   /**< Spins in a Period    */
+	const struct noise_generator *gen; /**< Noise Generator      */
+	spinlock_t lock;                   /**< Lock                 */
+} noise;
+
+/**
+ * @brief Arguments of noise threads.
+ */
+static struct ninfo
+{
+	int id;    /**< Instance ID         */
+	int serve; /**< Partner of a Burst? */
+} ninfo[NTHREADS_MAX];
+
+/**
+ * @brief Asserts whether noise threads should keep going.
+ */
+static int noise_running(void)
+{
+	int running;
+
+	spinlock_lock(&noise.lock);
+		running = noise.running;
+	spinlock_unlock(&noise.lock);
+
+	return (running);
+}
+
+/**
+ * @brief Spins without issuing kernel calls.
+ *
+ * @param n Number of iterations.
+ */
+static void noise_spin(uint64_t n)
+{
+	for (volatile uint64_t i = 0; i < n; i++)
+		/* noop */;
+}
+
+/**
+ * @brief Counts the spins that fit in a duty cycle period.
+ */
+static uint64_t noise_calibrate(void)
+{
+	uint64_t t0;
+	uint64_t t1;
+
+	kclock(&t0);
+		noise_spin(NOISE_CALIBRATION);
+	kclock(&t1);
+
+	return ((NOISE_CALIBRATION*NOISE_PERIOD)/((t1 > t0) ? (t1 - t0) : 1));
+}
+
+/**
+ * @brief Issues bursts of noise within a duty cycle until stopped.
+ *
+ * @details The clock is read only to find where a period is at. Out of
+ * the duty cycle, the thread spins until the next period without kernel
+ * calls, so that it adds no noise there.
+ */
+static void *task_noise(void *arg)
+{
+	uint64_t now;
+	uint64_t offset;
+	uint64_t active;
+	struct ninfo *n = arg;
+	const struct noise_generator *gen = noise.gen;
+
+	if (n->serve)
+	{
+		gen->serve(n->id);
+		return (NULL);
+	}
+
+	active = (NOISE_PERIOD*noise.duty)/100;
+
+	while (noise_running())
+	{
+		kclock(&now);
+		offset = now % NOISE_PERIOD;
+
+		if (offset < active)
+		{
+			gen->burst(n->id);
+			continue;
+		}
+
+		/* Spin idle out of the duty cycle. */
+		noise_spin(((NOISE_PERIOD - offset)*noise.nspins)/NOISE_PERIOD);
+	}
+
+	gen->stop(n->id);
+
+	return (NULL);
+}
+
+/**
+ * @brief Spawns noise threads.
+ *
+ * @param gen      Noise generator (NULL for no noise).
+ * @param duty     Duty cycle (in percent).
+ * @param nthreads Number of noise threads.
+ *
+ * @details Only as many instances of the generator as fit in nthreads
+ * are spawned.
+ */
+void noise_spawn(const struct noise_generator *gen, int duty, int nthreads)
+{
+	int ninstances;
+
+	noise.nthreads = 0;
+	noise.running = 1;
+	noise.duty = duty;
+	noise.gen = gen;
+	spinlock_init(&noise.lock);
+
+	if (gen == NULL)
+		return;
+
+	noise.nspins = noise_calibrate();
+
+	ninstances = nthreads/gen->nslots;
+	gen->setup(ninstances);
+
+	for (int i = 0; i < ninstances; i++)
+	{
+		ninfo[noise.nthreads].id = i;
+		ninfo[noise.nthreads].serve = 0;
+		kthread_create(&noise.tids[noise.nthreads], task_noise, &ninfo[noise.nthreads]);
+		noise.nthreads++;
+
+		if (gen->serve != NULL)
+		{
+			ninfo[noise.nthreads].id = i;
+			ninfo[noise.nthreads].serve = 1;
+			kthread_create(&noise.tids[noise.nthreads], task_noise, &ninfo[noise.nthreads]);
+			noise.nthreads++;
+		}
+	}
+}
+
+/**
+ * @brief Stops and joins noise threads.
+ */
+void noise_join(void)
+{
+	spinlock_lock(&noise.lock);
+		noise.running = 0;
+	spinlock_unlock(&noise.lock);
+
+	for (int i = 0; i < noise.nthreads; i++)
+		kthread_join(noise.tids[i], NULL);
+}
+
+#endif
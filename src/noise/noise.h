@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _NOISE_H_
+#define _NOISE_H_
+
+	#include <nanvix/sys/thread.h>
+	#include <nanvix/ulib.h>
+	#include <posix/stdint.h>
+	#include <kbench.h>
+
+	/**
+	 * @name Benchmark Parameters
+	 */
+	/**@{*/
+	#define NTHREADS_MIN                1  /**< Minimum Number of Worker Threads      */
+	#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Worker Threads      */
+	#define NTHREADS_STEP               1  /**< Increment on Number of Worker Threads */
+	#define FLOPS                 (10008)  /**< Number of Floating Point Operations   */
+	#define NIOOPS                  (100)  /**< Number of Floating Point Operations   */
+	/**@}*/
+
+	/**
+	 * @name Noise Generator Parameters
+	 *
+	 * @details A noise thread is active for the first duty percent of
+	 * every NOISE_PERIOD cycles and spins idle, without kernel calls,
+	 * for the rest of it.
+	 */
+	/**@{*/
+	#define NOISE_PERIOD (KBENCH_CLOCK_FREQ/1000)  /**< Duty Cycle Period (cycles)       */
+	#define NOISE_DUTY_MIN                     25  /**< Minimum Duty Cycle (%)           */
+	#define NOISE_DUTY_MAX                    100  /**< Maximum Duty Cycle (%)           */
+	#define NOISE_DUTY_STEP                    25  /**< Increment on Duty Cycle (%)      */
+	#define NOISE_HOG_SIZE                (64*KB)  /**< Memory Hog Buffer Size (bytes)   */
+	#define NOISE_HOG_CHUNK                (4*KB)  /**< Memory Hog Burst Size (bytes)    */
+	#define NOISE_PORTAL_SIZE              (1*KB)  /**< Portal Message Size (bytes)      */
+	#define NOISE_CALIBRATION               10000  /**< Spins Timed on Calibration       */
+	/**@}*/
+
+	/**
+	 * @name Bulk-Synchronous Parameters
+	 */
+	/**@{*/
+	#define BSP_NPHASES   100  /**< Number of Compute Phases */
+	#define BSP_FLOPS   FLOPS  /**< Work of a Compute Phase  */
+	/**@}*/
+
+	/**
+	 * @name Quanta Parameters
+	 *
+	 * @details A quantum is flagged as interrupted when it deviates from
+	 * the fastest one of its worker by more than NOISE_THRESHOLD percent.
+	 * Work units of fixed time quanta are large next to a kclock() call,
+	 * so that counts reflect work rather than clock reads.
+	 */
+	/**@{*/
+	#define NQUANTA                         2048  /**< Number of Quanta per Worker             */
+	#define FWQ_FLOPS                 (FLOPS/10)  /**< Work of a Fixed Work Quantum            */
+	#define FTQ_FLOPS                 (FLOPS/10)  /**< Work Unit of a Fixed Time Quantum       */
+	#define FTQ_CYCLES  (KBENCH_CLOCK_FREQ/1000)  /**< Length of a Fixed Time Quantum (cycles) */
+	#define NOISE_THRESHOLD                   10  /**< Deviation of an Interruption (%)        */
+	/**@}*/
+
+	/**
+	 * @brief Performs some FPU intensive computation.
+	 *
+	 * @param tmp   Accumulator.
+	 * @param flops Number of floating point operations.
+	 *
+	 * @returns The updated accumulator.
+	 */
+	static inline float do_flops(float tmp, int flops)
+	{
+		for (int k = 0; k < flops; k += 9)
+		{
+			register float k1 = k*1.1;
+			register float k2 = k*2.1;
+			register float k3 = k*3.1;
+			register float k4 = k*4.1;
+
+			tmp += k1 + k2 + k3 + k4;
+		}
+
+		return (tmp);
+	}
+
+	/**
+	 * @brief Noise generator.
+	 *
+	 * @details An instance of a generator takes nslots threads. The
+	 * first one issues bursts within its duty cycle and calls stop() on
+	 * its way out. If serve() is given, the second one is a partner that
+	 * answers those bursts until stopped. Otherwise, the second slot is
+	 * left to the generator itself (eg. for spawning threads).
+	 */
+	struct noise_generator
+	{
+		const char *name;                  /**< Generator Name               */
+		int nslots;                        /**< Threads per Instance         */
+		void (*setup)(int ninstances);     /**< Sets up instances.           */
+		void (*burst)(int id);             /**< Issues a burst of noise.     */
+		void (*serve)(int id);             /**< Answers bursts (optional).   */
+		void (*stop)(int id);              /**< Tears down an instance.      */
+	};
+
+	/**
+	 * @brief Number of noise generators.
+	 */
+	#define NOISE_GENERATORS_NUM 7
+
+	/**
+	 * @brief Noise generators.
+	 */
+	extern const struct noise_generator *noise_generators[NOISE_GENERATORS_NUM];
+
+	/**
+	 * @brief Gets the name of a noise generator.
+	 *
+	 * @param gen Target noise generator (NULL for no noise).
+	 */
+	static inline const char *noise_name(const struct noise_generator *gen)
+	{
+		return ((gen == NULL) ? "none" : gen->name);
+	}
+
+	/**
+	 * @name Noise Threads
+	 */
+	/**@{*/
+	extern void noise_spawn(const struct noise_generator *gen, int duty, int nthreads);
+	extern void noise_join(void);
+	/**@}*/
+
+	/**
+	 * @name Quanta Benchmarks
+	 */
+	/**@{*/
+	extern void benchmark_fwq(const struct noise_generator *gen, int duty, int nworkers, int nidle);
+	extern void benchmark_ftq(const struct noise_generator *gen, int duty, int nworkers, int nidle);
+	/**@}*/
+
+	/**
+	 * @brief Bulk-Synchronous Benchmark
+	 */
+	extern void benchmark_bsp(const struct noise_generator *gen, int duty, int nworkers, int nidle);
+
+#endif /* _NOISE_H_ */
@@ -0,0 +1,402 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "noise.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "noise"
+
+/*============================================================================*
+ * Noise Spectrum                                                             *
+ *============================================================================*/
+
+/**
+ * @brief Noise spectrum of a worker.
+ */
+struct spectrum
+{
+	int ninterruptions;  /**< Number of Interruptions           */
+	int nintervals;      /**< Number of Inter-Arrival Intervals */
+	uint64_t last;       /**< Position of Last Interruption     */
+	uint64_t total;      /**< Total Noise (cycles)              */
+	uint64_t max;        /**< Longest Interruption (cycles)     */
+};
+
+/**
+ * @brief Quanta traces.
+ *
+ * @details Traces are preallocated so that recording a quantum costs
+ * a single store.
+ */
+static uint32_t traces[NTHREADS_MAX][NQUANTA];
+
+/**
+ * @brief Intervals between interruptions.
+ */
+static uint64_t intervals[NQUANTA];
+
+/**
+ * @brief Histogram of interruption durations.
+ */
+static uint32_t durations[HISTOGRAM_BINS];
+
+/**
+ * @brief Accounts an interruption.
+ *
+ * @param s     Target spectrum.
+ * @param noise Duration of the interruption (in cycles).
+ * @param pos   Position of the interruption (in cycles).
+ */
+static void spectrum_add(struct spectrum *s, uint64_t noise, uint64_t pos)
+{
+	if (s->ninterruptions > 0)
+		intervals[s->nintervals++] = pos - s->last;
+
+	s->ninterruptions++;
+	s->last = pos;
+	s->total += noise;
+	if (noise > s->max)
+		s->max = noise;
+
+	histogram_add(durations, noise);
+}
+
+/**
+ * @brief Dump the noise spectrum of a worker.
+ *
+ * @param name     Benchmark name.
+ * @param mode     Benchmark mode.
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ * @param wid      ID of the worker.
+ * @param baseline Noiseless quantum (in cycles or work units).
+ * @param s        Noise spectrum.
+ *
+ * @details The period is the median interval between interruptions,
+ * which tells a periodic source (eg. a timer) from a random one.
+ */
+static void benchmark_dump_spectrum(
+	const char *name,
+	const char *mode,
+	const struct noise_generator *gen,
+	int duty,
+	int nworkers,
+	int nidle,
+	int wid,
+	uint64_t baseline,
+	struct spectrum *s
+)
+{
+	uint64_t period = 0;
+
+	if (s->nintervals > 0)
+	{
+		samples_sort(intervals, s->nintervals);
+		period = samples_percentile(intervals, s->nintervals, 500);
+	}
+
+	uprintf("[benchmarks][%s][%s] %s %d %d %d %d %d %d %d %d %d %d",
+		name,
+		mode,
+		noise_name(gen),
+		duty,
+		nworkers,
+		nidle,
+		wid,
+		NQUANTA,
+		UINT32(baseline),
+		s->ninterruptions,
+		UINT32(s->total),
+		UINT32(s->max),
+		UINT32(period)
+	);
+}
+
+/**
+ * @brief Dump the histogram of interruption durations.
+ *
+ * @param name     Benchmark name.
+ * @param mode     Benchmark mode.
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ */
+static void benchmark_dump_durations(
+	const char *name,
+	const char *mode,
+	const struct noise_generator *gen,
+	int duty,
+	int nworkers,
+	int nidle
+)
+{
+	for (int i = 0; i < HISTOGRAM_BINS; i++)
+	{
+		if (durations[i] == 0)
+			continue;
+
+		uprintf("[benchmarks][%s][%s][h] %s %d %d %d %d %d",
+			name,
+			mode,
+			noise_name(gen),
+			duty,
+			nworkers,
+			nidle,
+			UINT32((i == 0) ? 0 : (1ULL << i)),
+			durations[i]
+		);
+	}
+}
+
+/*============================================================================*
+ * Fixed Work Quantum                                                         *
+ *============================================================================*/
+
+/**
+ * @brief Worker scratch variables.
+ */
+static struct qdata
+{
+	int wid;        /**< Worker ID        */
+	float scratch;  /**< Scratch Variable */
+} qdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Times quanta of fixed work.
+ */
+static void *task_fwq(void *arg)
+{
+	uint64_t t0;
+	uint64_t t1;
+	struct qdata *t = arg;
+	uint32_t *trace = traces[t->wid];
+	float tmp = t->scratch;
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		kclock(&t0);
+			tmp = do_flops(tmp, FWQ_FLOPS);
+		kclock(&t1);
+
+		trace[q] = UINT32(t1 - t0);
+	}
+
+	/* Avoid compiler optimizations. */
+	t->scratch = tmp;
+
+	return (NULL);
+}
+
+/**
+ * @brief Extracts the noise spectrum of a fixed work trace.
+ *
+ * @details The fastest quantum is taken as noiseless, and the noise of
+ * any other is its excess over it.
+ */
+static void fwq_analyze(const struct noise_generator *gen, int duty, int nworkers, int nidle, int wid)
+{
+	uint64_t pos = 0;
+	uint32_t baseline = ~0U;
+	uint32_t threshold;
+	const uint32_t *trace = traces[wid];
+	struct spectrum s = { 0, 0, 0, 0, 0 };
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		if (trace[q] < baseline)
+			baseline = trace[q];
+	}
+
+	threshold = baseline + (baseline*NOISE_THRESHOLD)/100;
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		if (trace[q] > threshold)
+			spectrum_add(&s, trace[q] - baseline, pos);
+
+		pos += trace[q];
+	}
+
+	benchmark_dump_spectrum(BENCHMARK_NAME, "fwq", gen, duty, nworkers, nidle, wid, baseline, &s);
+}
+
+/*============================================================================*
+ * Fixed Time Quantum                                                         *
+ *============================================================================*/
+
+/**
+ * @brief Counts work units done in quanta of fixed time.
+ */
+static void *task_ftq(void *arg)
+{
+	uint64_t t0;
+	uint64_t now;
+	struct qdata *t = arg;
+	uint32_t *trace = traces[t->wid];
+	float tmp = t->scratch;
+
+	kclock(&t0);
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		uint32_t count = 0;
+		uint64_t deadline = t0 + (q + 1)*FTQ_CYCLES;
+
+		do
+		{
+			tmp = do_flops(tmp, FTQ_FLOPS);
+			count++;
+			kclock(&now);
+		} while (now < deadline);
+
+		trace[q] = count;
+	}
+
+	/* Avoid compiler optimizations. */
+	t->scratch = tmp;
+
+	return (NULL);
+}
+
+/**
+ * @brief Extracts the noise spectrum of a fixed time trace.
+ *
+ * @details The most productive quantum is taken as noiseless, and the
+ * work lost in any other is converted back to cycles.
+ */
+static void ftq_analyze(const struct noise_generator *gen, int duty, int nworkers, int nidle, int wid)
+{
+	uint32_t baseline = 0;
+	uint32_t threshold;
+	const uint32_t *trace = traces[wid];
+	struct spectrum s = { 0, 0, 0, 0, 0 };
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		if (trace[q] > baseline)
+			baseline = trace[q];
+	}
+
+	threshold = baseline - (baseline*NOISE_THRESHOLD)/100;
+
+	for (int q = 0; q < NQUANTA; q++)
+	{
+		if (trace[q] < threshold)
+		{
+			spectrum_add(&s,
+				((baseline - trace[q])*FTQ_CYCLES)/baseline,
+				q*FTQ_CYCLES
+			);
+		}
+	}
+
+	benchmark_dump_spectrum(BENCHMARK_NAME, "ftq", gen, duty, nworkers, nidle, wid, baseline, &s);
+}
+
+/*============================================================================*
+ * Quanta Benchmarks                                                          *
+ *============================================================================*/
+
+/**
+ * @brief Records quanta traces of worker threads under noise.
+ *
+ * @param task     Worker task.
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ */
+static void quanta_record(
+	void *(*task)(void *),
+	const struct noise_generator *gen,
+	int duty,
+	int nworkers,
+	int nidle
+)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	for (int i = 0; i < HISTOGRAM_BINS; i++)
+		durations[i] = 0;
+
+	/* Spawn noise threads first, so that we have a noisy system. */
+	noise_spawn(gen, duty, nidle);
+
+	for (int i = 0; i < nworkers; i++)
+	{
+		qdata[i].wid = i;
+		qdata[i].scratch = 0.0;
+		kthread_create(&tids[i], task, &qdata[i]);
+	}
+
+	for (int i = 0; i < nworkers; i++)
+		kthread_join(tids[i], NULL);
+
+	noise_join();
+}
+
+/**
+ * @brief Fixed Work Quantum Benchmark
+ *
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ */
+void benchmark_fwq(const struct noise_generator *gen, int duty, int nworkers, int nidle)
+{
+	quanta_record(task_fwq, gen, duty, nworkers, nidle);
+
+	for (int i = 0; i < nworkers; i++)
+		fwq_analyze(gen, duty, nworkers, nidle, i);
+
+	benchmark_dump_durations(BENCHMARK_NAME, "fwq", gen, duty, nworkers, nidle);
+}
+
+/**
+ * @brief Fixed Time Quantum Benchmark
+ *
+ * @param gen      Noise generator.
+ * @param duty     Duty cycle of noise (in percent).
+ * @param nworkers Number of worker threads.
+ * @param nidle    Number of noise threads.
+ */
+void benchmark_ftq(const struct noise_generator *gen, int duty, int nworkers, int nidle)
+{
+	quanta_record(task_ftq, gen, duty, nworkers, nidle);
+
+	for (int i = 0; i < nworkers; i++)
+		ftq_analyze(gen, duty, nworkers, nidle, i);
+
+	benchmark_dump_durations(BENCHMARK_NAME, "ftq", gen, duty, nworkers, nidle);
+}
+
+#endif
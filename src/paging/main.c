@@ -0,0 +1,310 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include <nanvix/sys/page.h>
+#include <nanvix/ulib.h>
+#include <posix/stdint.h>
+#include <kbench.h>
+#include "../comm/comm.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
+#define NTHREADS_STEP               1  /**< Increment on Number of Working Threads */
+/**@}*/
+
+/**
+ * @brief Number of pages mapped by all threads together.
+ *
+ * @details Keep it within the free page frames of the target.
+ */
+#ifndef NPAGES
+	#if defined(__mppa256__)
+		#define NPAGES 32
+	#elif defined(__optimsoc__)
+		#define NPAGES 64
+	#else
+		#define NPAGES 256
+	#endif
+#endif
+
+/**
+ * @brief Virtual address of a page.
+ */
+#define PAGE_VADDR(k) ((vaddr_t) (KBENCH_SCRATCH_VIRT + (k)*PAGE_SIZE))
+
+/**
+ * @brief Horizontal line.
+ */
+const char *HLINE =
+	"------------------------------------------------------------------------";
+
+/*============================================================================*
+ * Profiling                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "paging"
+
+/**
+ * @brief Dump statistics of a phase.
+ *
+ * @param it       Benchmark iteration.
+ * @param name     Benchmark name.
+ * @param phase    Phase name.
+ * @param nthreads Number of working threads.
+ * @param cycles   Time for all threads to go through the phase (in cycles).
+ * @param samples  Sorted latencies of pages.
+ *
+ * @details Throughput is given in pages per second.
+ */
+static void benchmark_dump_phase(
+	int it,
+	const char *name,
+	const char *phase,
+	int nthreads,
+	uint64_t cycles,
+	const uint64_t *samples
+)
+{
+	uprintf("[benchmarks][%s] %d %s %d %d %d %d %d %d %d %d",
+		name,
+		it,
+		phase,
+		nthreads,
+		NPAGES,
+		UINT32(cycles),
+		UINT32(cycles_to_rate(NPAGES, cycles)),
+		UINT32(samples_percentile(samples, NPAGES, 500)),
+		UINT32(samples_percentile(samples, NPAGES, 900)),
+		UINT32(samples_percentile(samples, NPAGES, 990)),
+		UINT32(samples[NPAGES - 1])
+	);
+}
+
+/*============================================================================*
+ * Phases                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Maps a page.
+ */
+static void page_map(int k)
+{
+	KASSERT(page_alloc(PAGE_VADDR(k)) == 0);
+}
+
+/**
+ * @brief Writes to a page.
+ */
+static void page_touch(int k)
+{
+	*((volatile word_t *) PAGE_VADDR(k)) = (word_t) k;
+}
+
+/**
+ * @brief Unmaps a page.
+ */
+static void page_unmap(int k)
+{
+	KASSERT(page_free(PAGE_VADDR(k)) == 0);
+}
+
+/**
+ * @brief Phases.
+ *
+ * @details There is no demand paging, so pages are mapped explicitly
+ * and the first write after that stands for the fault: it takes the
+ * TLB refill and cold cache lines of a fresh page. The second write
+ * finds them warm.
+ */
+static const struct phase
+{
+	const char *name;  /**< Phase name.       */
+	void (*op)(int k); /**< Operation on page. */
+} phases[] = {
+	{ "map",     page_map   },
+	{ "touch",   page_touch },
+	{ "retouch", page_touch },
+	{ "unmap",   page_unmap },
+};
+
+/**
+ * @brief Number of phases.
+ */
+#define NPHASES ((int) (sizeof(phases)/sizeof(phases[0])))
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tnum;     /**< Thread Number.       */
+	int nthreads; /**< Number of threads.   */
+	int first;    /**< First page.          */
+	int last;     /**< Page after the last. */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Latencies of operations on pages.
+ */
+static uint64_t samples[NPHASES][NPAGES];
+
+/**
+ * @brief Times of phases.
+ */
+static uint64_t cycles[NPHASES];
+
+/**
+ * @brief Goes through phases on the pages of a thread.
+ */
+static void *task(void *arg)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	struct tdata *t = arg;
+
+	barrier_cores_setup(t->tnum, t->nthreads);
+
+	for (int i = 0; i < NITERATIONS + SKIP; i++)
+	{
+		for (int p = 0; p < NPHASES; p++)
+		{
+			barrier_cores();
+			if (t->tnum == 0)
+				kclock(&t0);
+
+			for (int k = t->first; k < t->last; k++)
+			{
+				uint64_t s0, s1;
+
+				kclock(&s0);
+					phases[p].op(k);
+				kclock(&s1);
+
+				samples[p][k] = s1 - s0;
+			}
+
+			barrier_cores();
+			if (t->tnum == 0)
+			{
+				kclock(&t1);
+				cycles[p] = t1 - t0;
+			}
+		}
+
+		if ((i >= SKIP) && (t->tnum == 0))
+		{
+			for (int p = 0; p < NPHASES; p++)
+			{
+				samples_sort(samples[p], NPAGES);
+				benchmark_dump_phase(i - SKIP, BENCHMARK_NAME,
+					phases[p].name, t->nthreads, cycles[p], samples[p]
+				);
+			}
+		}
+	}
+
+	barrier_cores_cleanup(t->tnum);
+
+	return (NULL);
+}
+
+/**
+ * @brief Paging Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ *
+ * @details Threads split the pages evenly.
+ */
+static void kernel_paging(int nthreads)
+{
+	kthread_t tid[NTHREADS_MAX];
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		tdata[i].tnum = i;
+		tdata[i].nthreads = nthreads;
+		tdata[i].first = (i*NPAGES)/nthreads;
+		tdata[i].last = ((i + 1)*NPAGES)/nthreads;
+
+		kthread_create(&tid[i], task, &tdata[i]);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_join(tid[i], NULL);
+}
+
+#endif
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Paging Benchmark
+ *
+ * @param argc Argument counter.
+ * @param argv Argument variables.
+ */
+int __main2(int argc, const char *argv[])
+{
+	((void) argc);
+	((void) argv);
+
+#ifndef __qemu_riscv32__
+
+	uprintf(HLINE);
+
+#ifndef NDEBUG
+
+	kernel_paging(NTHREADS_MAX);
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+		kernel_paging(nthreads);
+
+#endif
+
+	uprintf(HLINE);
+
+#endif
+
+	return (0);
+}
@@ -0,0 +1,385 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include <nanvix/ulib.h>
+#include <posix/stdint.h>
+#include <kbench.h>
+#include "../comm/comm.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads  */
+#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads  */
+#define WSET_MIN              (1*1024) /**< Minimum Working Set (bytes)        */
+#define NLOADS               (1 << 16) /**< Number of Loads per Measurement    */
+/**@}*/
+
+/**
+ * @brief Size of the memory pool split among threads (in bytes).
+ *
+ * @details It also caps the working set of a single thread.
+ * Override it with ADDONS=-DPOOL_SIZE=<bytes> if needed.
+ */
+#ifndef POOL_SIZE
+	#if defined(__mppa256__)
+		#define POOL_SIZE (1024*1024)
+	#elif defined(__optimsoc__)
+		#define POOL_SIZE (4*1024*1024)
+	#else
+		#define POOL_SIZE (64*1024*1024)
+	#endif
+#endif
+
+/**
+ * @brief Horizontal line.
+ */
+const char *HLINE =
+	"------------------------------------------------------------------------";
+
+/**
+ * @name Benchmark Kernel Parameters
+ */
+/**@{*/
+static int NTHREADS;        /**< Number of Working Threads */
+static size_t WSET;         /**< Working Set (bytes)       */
+static const char *PATTERN; /**< Chain Pattern             */
+/**@}*/
+
+/*============================================================================*
+ * Profiling                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "pchase"
+
+/**
+ * @brief Number of events to profile.
+ */
+#if defined(__mppa256__)
+	#define BENCHMARK_PERF_EVENTS 2
+#elif defined(__optimsoc__)
+	#define BENCHMARK_PERF_EVENTS 2
+#else
+	#define BENCHMARK_PERF_EVENTS 1
+#endif
+
+/**
+ * Performance events.
+ */
+static int perf_events[BENCHMARK_PERF_EVENTS] = {
+#if defined(__mppa256__)
+	PERF_DTLB_STALLS,
+	PERF_DCACHE_STALLS,
+#elif defined(__optimsoc__)
+	MOR1KX_PERF_LSU_HITS,
+	MOR1KX_PERF_LSU_STALLS,
+#else
+	0
+#endif
+};
+
+/**
+ * @brief Dump execution statistics.
+ *
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param tnum   Thread number.
+ * @param cycles Time to issue NLOADS loads (in cycles).
+ * @param stats  Execution statistics.
+ *
+ * @details Load latency is printed in picoseconds, to keep sub
+ * nanosecond resolution on hits.
+ */
+static void benchmark_dump_stats(int it, const char *name, int tnum, uint64_t cycles, uint64_t *stats)
+{
+	uprintf(
+#if (BENCHMARK_PERF_EVENTS >= 2)
+		"[benchmarks][%s] %d %s %d %d %d %d %d %d %d",
+#else
+		"[benchmarks][%s] %d %s %d %d %d %d %d %d",
+#endif
+		name,
+		it,
+		PATTERN,
+		NTHREADS,
+		tnum,
+		WSET,
+		UINT32(cycles),
+		UINT32((cycles*1000000000ULL)/(KBENCH_CLOCK_FREQ*NLOADS/1000)),
+#if (BENCHMARK_PERF_EVENTS >= 2)
+		UINT32(stats[1]),
+#endif
+		UINT32(stats[0])
+	);
+}
+
+/*============================================================================*
+ * Chains                                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Chain patterns.
+ *
+ * @details Nodes are spread one per spacing bytes. Random chains defeat
+ * prefetchers, and page spacing makes every load a different page.
+ */
+static const struct pattern
+{
+	const char *name; /**< Pattern Name           */
+	size_t spacing;   /**< Node Spacing (bytes)   */
+	int random;       /**< Random Order?          */
+} patterns[] = {
+	{ "random-line", CACHE_LINE_SIZE, 1 },
+	{ "random-page", PAGE_SIZE,       1 },
+	{ "stride-line", CACHE_LINE_SIZE, 0 },
+	{ "stride-page", PAGE_SIZE,       0 },
+};
+
+/**
+ * @brief Number of chain patterns.
+ */
+#define NPATTERNS ((int) (sizeof(patterns)/sizeof(patterns[0])))
+
+/**
+ * @brief Memory pool.
+ */
+static char pool[POOL_SIZE] ALIGN(PAGE_SIZE);
+
+/**
+ * @brief Gets a node of a chain.
+ */
+#define NODE(base, spacing, i) ((uintptr_t *) ((base) + (i)*(spacing)))
+
+/**
+ * @brief Builds a chain that visits all nodes in a single cycle.
+ *
+ * @param base    Base address of the chain.
+ * @param wset    Working set (in bytes).
+ * @param p       Chain pattern.
+ * @param seed    Random seed.
+ *
+ * @details Random chains are built with Sattolo's shuffle, in place:
+ * node i first holds the index of its successor, and then the address.
+ */
+static void chain_build(char *base, size_t wset, const struct pattern *p, uint32_t seed)
+{
+	size_t nnodes = wset/p->spacing;
+
+	for (size_t i = 0; i < nnodes; i++)
+		*NODE(base, p->spacing, i) = (p->random) ? i : (i + 1)%nnodes;
+
+	if (p->random)
+	{
+		for (size_t i = nnodes - 1; i > 0; i--)
+		{
+			size_t j = rand_next(&seed)%i;
+			uintptr_t tmp = *NODE(base, p->spacing, i);
+
+			*NODE(base, p->spacing, i) = *NODE(base, p->spacing, j);
+			*NODE(base, p->spacing, j) = tmp;
+		}
+	}
+
+	for (size_t i = 0; i < nnodes; i++)
+		*NODE(base, p->spacing, i) = (uintptr_t) NODE(base, p->spacing, *NODE(base, p->spacing, i));
+}
+
+/**
+ * @brief Chases a chain.
+ *
+ * @param start First node.
+ * @param n     Number of loads.
+ *
+ * @returns The last node reached.
+ */
+static uintptr_t *chain_chase(uintptr_t *start, int n)
+{
+	uintptr_t *p = start;
+
+	for (int i = 0; i < n; i += 8)
+	{
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+		p = (uintptr_t *) *p;
+	}
+
+	return (p);
+}
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tnum;                /**< Thread Number        */
+	char *base;              /**< Base of Own Chain    */
+	const struct pattern *p; /**< Chain Pattern        */
+	uintptr_t *last;         /**< Last Node Reached    */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Chases the chain of a thread.
+ */
+static void *task(void *arg)
+{
+	uint64_t t0;
+	uint64_t t1;
+	struct tdata *t = arg;
+	uintptr_t *node = (uintptr_t *) t->base;
+	uint64_t stats[BENCHMARK_PERF_EVENTS];
+
+	barrier_cores_setup(t->tnum, NTHREADS);
+
+	/* Each thread touches its own chain first. */
+	chain_build(t->base, WSET, t->p, t->tnum + 1);
+
+	for (int i = 0; i < NITERATIONS + SKIP; i++)
+	{
+		for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+		{
+			barrier_cores();
+
+			perf_start(0, perf_events[j]);
+			kclock(&t0);
+
+				node = chain_chase(node, NLOADS);
+
+			kclock(&t1);
+			perf_stop(0);
+			stats[j] = perf_read(0);
+		}
+
+		if (i >= SKIP)
+			benchmark_dump_stats(i - SKIP, BENCHMARK_NAME, t->tnum, t1 - t0, stats);
+	}
+
+	/* Avoid compiler optimizations. */
+	t->last = node;
+
+	barrier_cores_cleanup(t->tnum);
+
+	return (NULL);
+}
+
+/**
+ * @brief Pointer Chasing Benchmark Kernel
+ *
+ * @param nthreads Number of working threads.
+ * @param wset     Working set of each thread (in bytes).
+ * @param p        Chain pattern.
+ */
+static void kernel_pchase(int nthreads, size_t wset, const struct pattern *p)
+{
+	size_t slice;
+	kthread_t tid[NTHREADS_MAX];
+
+	/* Each thread chases a chain of its own. */
+	slice = (POOL_SIZE/nthreads) & ~((size_t) PAGE_SIZE - 1);
+	if ((wset > slice) || ((wset/p->spacing) < 2))
+		return;
+
+	/* Save kernel parameters. */
+	NTHREADS = nthreads;
+	WSET = wset;
+	PATTERN = p->name;
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		tdata[i].tnum = i;
+		tdata[i].base = &pool[i*slice];
+		tdata[i].p = p;
+
+		kthread_create(&tid[i], task, &tdata[i]);
+	}
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_join(tid[i], NULL);
+}
+
+#endif
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Pointer Chasing Benchmark
+ *
+ * @param argc Argument counter.
+ * @param argv Argument variables.
+ */
+int __main2(int argc, const char *argv[])
+{
+	((void) argc);
+	((void) argv);
+
+#ifndef __qemu_riscv32__
+
+	uprintf(HLINE);
+
+#ifndef NDEBUG
+
+	for (int i = 0; i < NPATTERNS; i++)
+	{
+		for (size_t wset = WSET_MIN; wset <= POOL_SIZE; wset *= 2)
+			kernel_pchase(NTHREADS_MIN, wset, &patterns[i]);
+	}
+
+#else
+
+	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads *= 2)
+	{
+		for (int i = 0; i < NPATTERNS; i++)
+		{
+			for (size_t wset = WSET_MIN; wset <= POOL_SIZE; wset *= 2)
+				kernel_pchase(nthreads, wset, &patterns[i]);
+		}
+	}
+
+#endif
+
+	uprintf(HLINE);
+
+#endif
+
+	return (0);
+}
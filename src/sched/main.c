@@ -0,0 +1,401 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/thread.h>
+#include <nanvix/ulib.h>
+#include <posix/stdint.h>
+#include <kbench.h>
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @name Benchmark Parameters
+ */
+/**@{*/
+#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads      */
+#define NTHREADS_MAX       THREAD_MAX  /**< Bound on Number of Working Threads     */
+#define NTHREADS_STEP               1  /**< Increment on Number of Working Threads */
+#define CHUNK                    1024  /**< Iterations of a Work Chunk             */
+#define NCHUNKS_CLOCK               8  /**< Work Chunks Between Clock Reads        */
+#define WINDOW (KBENCH_CLOCK_FREQ/100) /**< Measurement Window (cycles)            */
+/**@}*/
+
+/**
+ * @brief Number of cores available to working threads.
+ *
+ * @details All cores but the master one, which serves kernel calls.
+ * Working threads oversubscribe the cluster past this number, which
+ * the sweep reaches only if the kernel runs more threads than cores.
+ */
+#define NCORES (CORES_NUM - 1)
+
+/**
+ * @brief Horizontal line.
+ */
+static const char *HLINE =
+	"------------------------------------------------------------------------";
+
+/*============================================================================*
+ * Profiling                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "sched"
+
+/**
+ * @brief Dump results of a run.
+ *
+ * @param it       Benchmark iteration.
+ * @param name     Benchmark name.
+ * @param workload Workload name.
+ * @param nthreads Number of working threads.
+ * @param rate     Throughput of all threads (in chunks per second).
+ * @param baseline Throughput of a single thread (in chunks per second).
+ * @param progress Chunks done by each thread.
+ *
+ * @details Progress is the number of chunks that each thread did
+ * within WINDOW cycles. Efficiency is the throughput over that of one
+ * thread per busy core, and the fairness index is that of progress
+ * across threads. Both are given in permille.
+ */
+static void benchmark_dump(
+	int it,
+	const char *name,
+	const char *workload,
+	int nthreads,
+	uint64_t rate,
+	uint64_t baseline,
+	uint64_t *progress
+)
+{
+	uint64_t ideal;
+	uint64_t fairness;
+
+	ideal = baseline*((nthreads < NCORES) ? nthreads : NCORES);
+	fairness = fairness_index(progress, nthreads);
+
+	samples_sort(progress, nthreads);
+
+	uprintf("[benchmarks][%s] %d %s %d %d %d %d %d %d %d %d",
+		name,
+		it,
+		workload,
+		nthreads,
+		NCORES,
+		UINT32(rate),
+		UINT32((ideal > 0) ? (rate*1000)/ideal : 0),
+		UINT32(fairness),
+		UINT32(progress[0]),
+		UINT32(samples_percentile(progress, nthreads, 500)),
+		UINT32(progress[nthreads - 1])
+	);
+}
+
+/*============================================================================*
+ * Workloads                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Workloads.
+ *
+ * @details In the mixed workload, odd threads are interactive: they
+ * yield the core after each chunk. The others are CPU-bound.
+ */
+static const struct workload
+{
+	const char *name; /**< Workload Name            */
+	int interactive;  /**< Odd threads interactive? */
+} workloads[] = {
+	{ "cpu",   0 },
+	{ "mixed", 1 },
+};
+
+/**
+ * @brief Number of workloads.
+ */
+#define NWORKLOADS ((int) (sizeof(workloads)/sizeof(workloads[0])))
+
+/**
+ * @brief Does a chunk of work.
+ *
+ * @param x Seed.
+ *
+ * @returns The new seed.
+ */
+static word_t work(word_t x)
+{
+	for (int i = 0; i < CHUNK; i++)
+		x = x*1103515245 + 12345;
+
+	return (x);
+}
+
+/*============================================================================*
+ * Benchmark                                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Thread info.
+ */
+static struct tdata
+{
+	int tnum;         /**< Thread Number                 */
+	int interactive;  /**< Yields after each chunk?      */
+	uint64_t nchunks; /**< Chunks done within the window */
+	word_t sink;      /**< Result of work                */
+} tdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @name Start of a Run
+ */
+/**@{*/
+static volatile int nready;  /**< Threads ready to start.  */
+static volatile int started; /**< Has the run started?     */
+static uint64_t start;       /**< Start of the window.     */
+/**@}*/
+
+/**
+ * @brief Progress of threads.
+ */
+static uint64_t progress[NTHREADS_MAX];
+
+/**
+ * @brief Works until the window closes.
+ *
+ * @details Threads poll with yields rather than meeting at a barrier,
+ * which would not make progress with more threads than cores. Each
+ * thread watches the clock itself, so that one that is not scheduled
+ * within the window does no work. The clock is read only every
+ * NCHUNKS_CLOCK chunks, so that threads do not mostly contend on
+ * kernel calls.
+ */
+static void *task(void *arg)
+{
+	uint64_t now;
+	struct tdata *t = arg;
+	word_t x = (word_t) t->tnum;
+
+	__sync_fetch_and_add(&nready, 1);
+	while (!started)
+		kthread_yield();
+
+	t->nchunks = 0;
+	for (;;)
+	{
+		kclock(&now);
+		if ((now - start) >= WINDOW)
+			break;
+
+		for (int i = 0; i < NCHUNKS_CLOCK; i++)
+		{
+			x = work(x);
+			t->nchunks++;
+
+			if (t->interactive)
+				kthread_yield();
+		}
+	}
+
+	t->sink = x;
+
+	return (NULL);
+}
+
+/**
+ * @brief Scheduler Benchmark Kernel
+ *
+ * @param w        Workload.
+ * @param nthreads Number of working threads.
+ *
+ * @returns The throughput of all threads (in chunks per second).
+ */
+static uint64_t kernel_sched(const struct workload *w, int nthreads)
+{
+	uint64_t nchunks = 0;
+	kthread_t tid[NTHREADS_MAX];
+
+	nready = 0;
+	started = 0;
+
+	/* Spawn threads. */
+	for (int i = 0; i < nthreads; i++)
+	{
+		tdata[i].tnum = i;
+		tdata[i].interactive = w->interactive && (i & 1);
+
+		kthread_create(&tid[i], task, &tdata[i]);
+	}
+
+	/* Open the window. */
+	while (nready < nthreads)
+		kthread_yield();
+	kclock(&start);
+	__sync_synchronize();
+	started = 1;
+
+	/* Wait for threads. */
+	for (int i = 0; i < nthreads; i++)
+		kthread_join(tid[i], NULL);
+
+	for (int i = 0; i < nthreads; i++)
+	{
+		progress[i] = tdata[i].nchunks;
+		nchunks += tdata[i].nchunks;
+	}
+
+	return (cycles_to_rate(nchunks, WINDOW));
+}
+
+/**
+ * @brief Holds probing threads until all of them are spawned.
+ */
+static volatile int parked;
+
+/**
+ * @brief Parks until the probe is over.
+ */
+static void *park(void *arg)
+{
+	UNUSED(arg);
+
+	while (parked)
+		kthread_yield();
+
+	return (NULL);
+}
+
+/**
+ * @brief Finds how many working threads the kernel runs at once.
+ *
+ * @returns The number of threads that were spawned together.
+ *
+ * @details Threads are spawned until the kernel refuses one, and none
+ * of them exits before the last one is spawned.
+ */
+static int nthreads_probe(void)
+{
+	int n;
+	kthread_t tid[NTHREADS_MAX];
+
+	parked = 1;
+	__sync_synchronize();
+
+	for (n = 0; n < NTHREADS_MAX; n++)
+	{
+		if (kthread_create(&tid[n], park, NULL) != 0)
+			break;
+	}
+
+	parked = 0;
+	__sync_synchronize();
+
+	for (int i = 0; i < n; i++)
+		kthread_join(tid[i], NULL);
+
+	return (n);
+}
+
+/**
+ * @brief Measures the throughput of a single thread.
+ *
+ * @param w Workload.
+ *
+ * @returns The throughput of a single thread (in chunks per second).
+ */
+static uint64_t benchmark_baseline(const struct workload *w)
+{
+	for (int it = 0; it < SKIP; it++)
+		kernel_sched(w, 1);
+
+	return (kernel_sched(w, 1));
+}
+
+/**
+ * @brief Runs a workload with some number of threads.
+ *
+ * @param w        Workload.
+ * @param nthreads Number of working threads.
+ * @param baseline Throughput of a single thread (in chunks per second).
+ */
+static void benchmark_sched(const struct workload *w, int nthreads, uint64_t baseline)
+{
+	for (int it = 0; it < NITERATIONS + SKIP; it++)
+	{
+		uint64_t rate = kernel_sched(w, nthreads);
+
+		if (it >= SKIP)
+			benchmark_dump(it - SKIP, BENCHMARK_NAME, w->name, nthreads, rate, baseline, progress);
+	}
+}
+
+#endif
+
+/*============================================================================*
+ * Benchmark Driver                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Scheduler Fairness Benchmark
+ *
+ * @param argc Argument counter.
+ * @param argv Argument variables.
+ */
+int __main2(int argc, const char *argv[])
+{
+	((void) argc);
+	((void) argv);
+
+#ifndef __qemu_riscv32__
+
+	int nthreads_max;
+
+	uprintf(HLINE);
+
+	nthreads_max = nthreads_probe();
+	KASSERT(nthreads_max >= NTHREADS_MIN);
+
+	for (int k = 0; k < NWORKLOADS; k++)
+	{
+		uint64_t baseline = benchmark_baseline(&workloads[k]);
+
+#ifndef NDEBUG
+
+		benchmark_sched(&workloads[k], nthreads_max, baseline);
+
+#else
+
+		for (int nthreads = NTHREADS_MIN; nthreads <= nthreads_max; nthreads += NTHREADS_STEP)
+			benchmark_sched(&workloads[k], nthreads, baseline);
+
+#endif
+	}
+
+	uprintf(HLINE);
+
+#endif
+
+	return (0);
+}
@@ -0,0 +1,287 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "server.h"
+
+#ifndef __qemu_riscv32__
+
+/*============================================================================*
+ * Batching Dispatcher                                                        *
+ *============================================================================*/
+
+/**
+ * @brief Maximum number of requests taken by a worker at once.
+ */
+#define BATCH_SIZE 8
+
+/**
+ * @brief Capacity of the request queue (power of two).
+ */
+#define QUEUE_SIZE 128
+
+/**
+ * @brief Server information.
+ */
+static struct
+{
+	kthread_t tids[NTHREADS_MAX];      /**< IDs of Worker Threads         */
+	int nworkers;                      /**< Number of Worker Threads      */
+	int head;                          /**< Head of the Queue             */
+	int tail;                          /**< Tail of the Queue             */
+	int pending;                       /**< Requests Not Completed Yet    */
+	int nawake;                        /**< Worker Threads Not Sleeping   */
+	int nsleeping;                     /**< Worker Threads Sleeping       */
+	int shutdown;                      /**< Shutdown Signal               */
+	uint64_t calls;                    /**< Semaphore Calls of Dispatcher */
+	spinlock_t lock;                   /**< Queue Lock                    */
+	struct nanvix_semaphore wakeup;    /**< Wake Up Some Worker?          */
+	struct request *queue[QUEUE_SIZE]; /**< Request Queue                 */
+} binfo;
+
+/**
+ * @brief Worker threads.
+ */
+static struct bworker
+{
+	uint64_t calls; /**< Semaphore Calls  */
+	float scratch;  /**< Scratch Variable */
+} bworkers[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Worker thread.
+ *
+ * @details A worker grabs up to BATCH_SIZE requests per acquisition of
+ * the queue lock and reports completions of a batch when it comes back
+ * for the next one. It keeps draining the queue without going through
+ * the semaphore, and only sleeps when the queue is empty.
+ */
+static void *batch_worker(void *arg)
+{
+	int n = 0;
+	struct bworker *w = arg;
+	struct request *batch[BATCH_SIZE];
+
+	while (1)
+	{
+		int sleep = 0;
+		int shutdown = 0;
+
+		spinlock_lock(&binfo.lock);
+
+			binfo.pending -= n;
+
+			/* Grab a batch. */
+			for (n = 0; (n < BATCH_SIZE) && (binfo.head != binfo.tail); n++)
+				batch[n] = binfo.queue[binfo.head++ & (QUEUE_SIZE - 1)];
+
+			if (n == 0)
+			{
+				/* Shutdown signal. */
+				if (binfo.shutdown)
+					shutdown = 1;
+				else
+				{
+					binfo.nawake--;
+					binfo.nsleeping++;
+					sleep = 1;
+				}
+			}
+
+		spinlock_unlock(&binfo.lock);
+
+		if (shutdown)
+			break;
+
+		if (sleep)
+		{
+			w->calls++;
+			nanvix_semaphore_down(&binfo.wakeup);
+			continue;
+		}
+
+		/* Requests are picked up one after another. */
+		for (int i = 0; i < n; i++)
+		{
+			kclock(&batch[i]->wakeup);
+			request_serve(batch[i], &w->scratch);
+		}
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Starts up the server.
+ *
+ * @param nworkers Number of worker threads.
+ */
+static void batch_startup(int nworkers)
+{
+	binfo.nworkers = nworkers;
+	binfo.head = 0;
+	binfo.tail = 0;
+	binfo.pending = 0;
+	binfo.nawake = nworkers;
+	binfo.nsleeping = 0;
+	binfo.shutdown = 0;
+	binfo.calls = 0;
+	spinlock_init(&binfo.lock);
+	nanvix_semaphore_init(&binfo.wakeup, 0);
+
+	/* Spawn worker threads. */
+	for (int i = 0; i < nworkers; i++)
+	{
+		bworkers[i].calls = 0;
+		bworkers[i].scratch = 0.0;
+		kthread_create(&binfo.tids[i], batch_worker, &bworkers[i]);
+	}
+}
+
+/**
+ * @brief Enqueues a request.
+ *
+ * @param req Target request.
+ *
+ * @returns Zero if the request was enqueued, and non-zero if the queue
+ * is full.
+ *
+ * @details A sleeping worker is woken up only when the awake ones have
+ * more than a full batch each to go through. Otherwise, the wakeup is
+ * coalesced into the next batch of some running worker.
+ */
+static int batch_trydispatch(struct request *req)
+{
+	int wakeup = 0;
+
+	kclock(&req->dispatch);
+
+	spinlock_lock(&binfo.lock);
+
+		if ((binfo.tail - binfo.head) == QUEUE_SIZE)
+		{
+			spinlock_unlock(&binfo.lock);
+			return (-1);
+		}
+
+		binfo.queue[binfo.tail++ & (QUEUE_SIZE - 1)] = req;
+		binfo.pending++;
+
+		if ((binfo.nsleeping > 0) && ((binfo.tail - binfo.head) > binfo.nawake*BATCH_SIZE))
+		{
+			binfo.nsleeping--;
+			binfo.nawake++;
+			wakeup = 1;
+		}
+
+	spinlock_unlock(&binfo.lock);
+
+	if (wakeup)
+	{
+		binfo.calls++;
+		nanvix_semaphore_up(&binfo.wakeup);
+	}
+
+	return (0);
+}
+
+/**
+ * @brief Enqueues a request.
+ *
+ * @param req Target request.
+ */
+static void batch_dispatch(struct request *req)
+{
+	while (batch_trydispatch(req) != 0)
+		/* noop */;
+}
+
+/**
+ * @brief Waits for all enqueued requests to complete.
+ */
+static void batch_drain(void)
+{
+	int pending;
+
+	do
+	{
+		spinlock_lock(&binfo.lock);
+			pending = binfo.pending;
+		spinlock_unlock(&binfo.lock);
+	} while (pending > 0);
+}
+
+/**
+ * @brief Counts mutex and semaphore calls issued to serve requests.
+ */
+static uint64_t batch_syscalls(void)
+{
+	uint64_t calls = binfo.calls;
+
+	for (int i = 0; i < binfo.nworkers; i++)
+		calls += bworkers[i].calls;
+
+	return (calls);
+}
+
+/**
+ * @brief Shuts down the server.
+ */
+static void batch_shutdown(void)
+{
+	int nsleeping;
+
+	/* Broadcast shutdown signal. */
+	spinlock_lock(&binfo.lock);
+		binfo.shutdown = 1;
+		nsleeping = binfo.nsleeping;
+		binfo.nawake += nsleeping;
+		binfo.nsleeping = 0;
+	spinlock_unlock(&binfo.lock);
+
+	for (int i = 0; i < nsleeping; i++)
+		nanvix_semaphore_up(&binfo.wakeup);
+
+	/* Join worker threads. */
+	for (int i = 0; i < binfo.nworkers; i++)
+		kthread_join(binfo.tids[i], NULL);
+}
+
+/**
+ * @brief Batching engine.
+ *
+ * @details Requests go into a single queue that workers drain in
+ * batches, and wakeups are coalesced so that a request costs no
+ * semaphore call when some worker is already running.
+ */
+const struct server_engine engine_batch = {
+	.name        = "batch",
+	.startup     = batch_startup,
+	.dispatch    = batch_dispatch,
+	.trydispatch = batch_trydispatch,
+	.drain       = batch_drain,
+	.syscalls    = batch_syscalls,
+	.shutdown    = batch_shutdown,
+};
+
+#endif
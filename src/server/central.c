@@ -0,0 +1,243 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2018 Pedro Henrique Penna <pedrohenriquepenna@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "server.h"
+
+#ifndef __qemu_riscv32__
+
+/*============================================================================*
+ * Centralized Dispatcher                                                     *
+ *============================================================================*/
+
+/**
+ * @brief Server information.
+ */
+static struct
+{
+	kthread_t tids[NTHREADS_MAX];      /**< IDs of Worker Threads         */
+	int nworkers;                      /**< Number of Worker Threads      */
+	uint64_t calls;                    /**< Blocking Calls of Dispatcher  */
+	struct nanvix_mutex lock;          /**< Server Lock                   */
+	struct nanvix_semaphore workers;   /**< Number of Idle Worker Threads */
+} sinfo;
+
+/**
+ * @brief Worker threads.
+ */
+static struct winfo
+{
+	int idle;                       /**< Idle Worker?      */
+	uint64_t calls;                 /**< Blocking Calls    */
+	struct request *request;        /**< Current Request   */
+	float scratch;                  /**< scratch variable. */
+	struct nanvix_semaphore wakeup; /**< Wake Up Worker?   */
+} workers[NTHREADS_MAX];
+
+/**
+ * @brief Worker thread.
+ */
+static void *worker(void *arg)
+{
+	struct winfo *t = arg;
+
+	while (1)
+	{
+		nanvix_semaphore_down(&t->wakeup);
+
+		/* Shutdown signal. */
+		if (t->request == NULL)
+			break;
+
+		kclock(&t->request->wakeup);
+		request_serve(t->request, &t->scratch);
+
+		nanvix_mutex_lock(&sinfo.lock);
+			t->idle = 1;
+		nanvix_mutex_unlock(&sinfo.lock);
+		nanvix_semaphore_up(&sinfo.workers);
+
+		/* Down, lock, unlock and up. */
+		t->calls += 4;
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Starts up the sinfo.
+ *
+ * @param nworkers  Number of worker threads.
+ */
+static void central_startup(int nworkers)
+{
+	/* Initialize sinfo. */
+	sinfo.nworkers = nworkers;
+	sinfo.calls = 0;
+	nanvix_mutex_init(&sinfo.lock);
+	nanvix_semaphore_init(&sinfo.workers, nworkers);
+
+	/* Spawn worker threads. */
+	for (int i = 0; i < nworkers; i++)
+	{
+		workers[i].idle = 1;
+		workers[i].calls = 0;
+		nanvix_semaphore_init(&workers[i].wakeup, 0);
+		kthread_create(&sinfo.tids[i], worker, &workers[i]);
+	}
+}
+
+/**
+ * @brief Hands a request to an idle worker thread.
+ *
+ * @param req Target request.
+ *
+ * @note The caller must have acquired an idle worker thread.
+ */
+static void central_assign(struct request *req)
+{
+	kclock(&req->dispatch);
+
+	nanvix_mutex_lock(&sinfo.lock);
+
+	/* Dispatch request to an idle worker thread. */
+	for (int i = 0; i < sinfo.nworkers; i++)
+	{
+		if (workers[i].idle)
+		{
+			workers[i].request = req;
+			workers[i].idle = 0;
+			nanvix_semaphore_up(&workers[i].wakeup);
+			break;
+		}
+	}
+
+	nanvix_mutex_unlock(&sinfo.lock);
+
+	/* Lock, up and unlock. */
+	sinfo.calls += 3;
+}
+
+/**
+ * @brief Dispatches a request to an idle worker thread.
+ *
+ * @param req Target request.
+ */
+static void central_dispatch(struct request *req)
+{
+	nanvix_semaphore_down(&sinfo.workers);
+	sinfo.calls++;
+
+	central_assign(req);
+}
+
+/**
+ * @brief Dispatches a request if some worker thread is idle.
+ *
+ * @param req Target request.
+ *
+ * @returns Zero if the request was dispatched, and non-zero otherwise.
+ */
+static int central_trydispatch(struct request *req)
+{
+	sinfo.calls++;
+	if (nanvix_semaphore_trydown(&sinfo.workers) != 0)
+		return (-1);
+
+	central_assign(req);
+
+	return (0);
+}
+
+/**
+ * @brief Waits for all worker threads to become idle.
+ */
+static void central_drain(void)
+{
+	for (int i = 0; i < sinfo.nworkers; i++)
+		nanvix_semaphore_down(&sinfo.workers);
+	for (int i = 0; i < sinfo.nworkers; i++)
+		nanvix_semaphore_up(&sinfo.workers);
+}
+
+/**
+ * @brief Counts mutex and semaphore calls issued to serve requests.
+ */
+static uint64_t central_syscalls(void)
+{
+	uint64_t calls = sinfo.calls;
+
+	for (int i = 0; i < sinfo.nworkers; i++)
+		calls += workers[i].calls;
+
+	return (calls);
+}
+
+/**
+ * @brief Shuts down the sinfo.
+ */
+static void central_shutdown(void)
+{
+again:
+
+	nanvix_mutex_lock(&sinfo.lock);
+
+		/* Broadcast shutdown signal. */
+		for (int i = 0; i < sinfo.nworkers; i++)
+		{
+			if (!workers[i].idle)
+			{
+				nanvix_mutex_unlock(&sinfo.lock);
+				goto again;
+			}
+
+			/* Shutdown signal. */
+			workers[i].request = NULL;
+			nanvix_semaphore_up(&workers[i].wakeup);
+		}
+
+	nanvix_mutex_unlock(&sinfo.lock);
+
+	/* Join worker threads. */
+	for (int i = 0; i < sinfo.nworkers; i++)
+		kthread_join(sinfo.tids[i], NULL);
+
+}
+
+/**
+ * @brief Centralized dispatcher engine.
+ *
+ * @details The dispatcher takes the server lock and linearly scans the
+ * worker threads for an idle one on every request.
+ */
+const struct server_engine engine_central = {
+	.name        = "central",
+	.startup     = central_startup,
+	.dispatch    = central_dispatch,
+	.trydispatch = central_trydispatch,
+	.drain       = central_drain,
+	.syscalls    = central_syscalls,
+	.shutdown    = central_shutdown,
+};
+
+#endif
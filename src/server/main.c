@@ -23,26 +23,10 @@
  */
 
 #include <nanvix/sys/perf.h>
-#include <nanvix/sys/thread.h>
-#include <nanvix/sys/mutex.h>
-#include <nanvix/sys/semaphore.h>
-#include <nanvix/ulib.h>
-#include <posix/stdint.h>
-#include <kbench.h>
+#include "server.h"
 
 #ifndef __qemu_riscv32__
 
-/**
- * @name Benchmark Parameters
- */
-/**@{*/
-#define NTHREADS_MIN                1  /**< Minimum Number of Worker Threads      */
-#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Worker Threads      */
-#define NTHREADS_STEP               1  /**< Increment on Number of Worker Threads */
-#define NREQUESTS                1000  /**< Number of Requests                    */
-#define FLOPS                   10008  /**< Number of Floating Point Operations   */
-/**@}*/
-
 /**
  * @brief Horizontal line.
  */
@@ -53,9 +37,39 @@ static const char *HLINE =
  * @name Benchmark Kernel Parameters
  */
 /**@{*/
-static int NWORKERS; /**< Number of Worker Threads */
+static int NWORKERS;        /**< Number of Worker Threads */
+static const char *ENGINE;  /**< Server Engine            */
 /**@}*/
 
+/**
+ * @brief Server engines.
+ */
+static const struct server_engine *engines[] = {
+	&engine_central,
+	&engine_steal,
+	&engine_batch,
+};
+
+/**
+ * @brief Phases of a request.
+ */
+enum phase
+{
+	PHASE_QUEUEING, /**< From Enqueue to Dispatch      */
+	PHASE_WAKEUP,   /**< From Dispatch to Worker Pickup */
+	PHASE_SERVICE,  /**< From Start to Completion       */
+	PHASE_NUM       /**< Number of Phases               */
+};
+
+/**
+ * @brief Names of request phases.
+ */
+static const char *phase_names[PHASE_NUM] = {
+	"queueing",
+	"wakeup",
+	"service",
+};
+
 /*============================================================================*
  * Profilling                                                                 *
  *============================================================================*/
@@ -118,14 +132,15 @@ static void benchmark_dump_stats(
 {
 	uprintf(
 #if defined(__mppa256__)
-		"[benchmarks][%s][u] %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s][u] %d %s %d %d %d %d %d %d %d %d %d",
 #elif defined(__optimsoc__)
-		"[benchmarks][%s][u] %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s][u] %d %s %d %d %d %d %d %d %d %d %d",
 #else
-		"[benchmarks][%s][u] %d %d %d %d",
+		"[benchmarks][%s][u] %d %s %d %d %d",
 #endif
 		name,
 		it,
+		ENGINE,
 		NWORKERS,
 		NREQUESTS,
 #if defined(__mppa256__)
@@ -151,14 +166,15 @@ static void benchmark_dump_stats(
 
 	uprintf(
 #if defined(__mppa256__)
-		"[benchmarks][%s][k] %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s][k] %d %s %d %d %d %d %d %d %d %d %d",
 #elif defined(__optimsoc__)
-		"[benchmarks][%s][k] %d %d %d %d %d %d %d %d %d %d",
+		"[benchmarks][%s][k] %d %s %d %d %d %d %d %d %d %d %d",
 #else
-		"[benchmarks][%s][k] %d %d %d %d",
+		"[benchmarks][%s][k] %d %s %d %d %d",
 #endif
 		name,
 		it,
+		ENGINE,
 		NWORKERS,
 		NREQUESTS,
 #if defined(__mppa256__)
@@ -183,189 +199,459 @@ static void benchmark_dump_stats(
 	);
 }
 
+/**
+ * @brief Dump throughput and dispatch latency.
+ *
+ * @param it     Benchmark iteration.
+ * @param name   Benchmark name.
+ * @param cycles Time to serve all requests (in cycles).
+ * @param calls  Blocking calls issued to serve all requests.
+ * @param reqs   Served requests.
+ * @param nreqs  Number of served requests.
+ *
+ * @details Blocking calls are reported per request, in permille.
+ */
+static void benchmark_dump_latency(
+	int it,
+	const char *name,
+	uint64_t cycles,
+	uint64_t calls,
+	const struct request *reqs,
+	int nreqs
+)
+{
+	uint64_t min = ~0ULL;
+	uint64_t max = 0;
+	uint64_t sum = 0;
+
+	/* Dispatch latency: from enqueue to service start. */
+	for (int i = 0; i < nreqs; i++)
+	{
+		uint64_t latency = reqs[i].start - reqs[i].enqueue;
+
+		if (latency < min)
+			min = latency;
+		if (latency > max)
+			max = latency;
+		sum += latency;
+	}
+
+	uprintf("[benchmarks][%s][t] %d %s %d %d %d %d %d %d %d %d",
+		name,
+		it,
+		ENGINE,
+		NWORKERS,
+		nreqs,
+		UINT32(cycles),
+		UINT32(cycles_to_rate(nreqs, cycles)),
+		UINT32((calls*1000)/nreqs),
+		UINT32(min),
+		UINT32(sum/nreqs),
+		UINT32(max)
+	);
+}
+
+/**
+ * @brief Dump latency percentiles of an open-loop run.
+ *
+ * @param it        Benchmark iteration.
+ * @param name      Benchmark name.
+ * @param arrival   Arrival process.
+ * @param dist      Service time distribution.
+ * @param type      Request type.
+ * @param load      Offered load (in percent of capacity).
+ * @param offered   Offered throughput (in requests per second).
+ * @param achieved  Achieved throughput (in requests per second).
+ * @param samples   Sorted request latencies.
+ * @param nreqs     Number of served requests.
+ */
+static void benchmark_dump_percentiles(
+	int it,
+	const char *name,
+	const char *arrival,
+	const char *dist,
+	const char *type,
+	int load,
+	uint64_t offered,
+	uint64_t achieved,
+	const uint64_t *samples,
+	int nreqs
+)
+{
+	uprintf("[benchmarks][%s][o] %d %s %s %s %s %d %d %d %d %d %d %d %d %d %d",
+		name,
+		it,
+		ENGINE,
+		arrival,
+		dist,
+		type,
+		NWORKERS,
+		load,
+		UINT32(offered),
+		UINT32(achieved),
+		nreqs,
+		UINT32(samples_percentile(samples, nreqs, 500)),
+		UINT32(samples_percentile(samples, nreqs, 900)),
+		UINT32(samples_percentile(samples, nreqs, 990)),
+		UINT32(samples_percentile(samples, nreqs, 999)),
+		UINT32(samples[nreqs - 1])
+	);
+}
+
+/**
+ * @brief Dump latency histograms of request phases.
+ *
+ * @param it   Benchmark iteration.
+ * @param name Benchmark name.
+ * @param bins Histograms of request phases.
+ *
+ * @details One line is printed for each non-empty bin, with the lower
+ * bound of the bin (in cycles) and its number of samples.
+ */
+static void benchmark_dump_breakdown(
+	int it,
+	const char *name,
+	uint32_t bins[PHASE_NUM][HISTOGRAM_BINS]
+)
+{
+	for (int i = 0; i < PHASE_NUM; i++)
+	{
+		for (int j = 0; j < HISTOGRAM_BINS; j++)
+		{
+			if (bins[i][j] == 0)
+				continue;
+
+			uprintf("[benchmarks][%s][h] %d %s %d %s %d %d",
+				name,
+				it,
+				ENGINE,
+				NWORKERS,
+				phase_names[i],
+				UINT32((j == 0) ? 0 : (1ULL << j)),
+				bins[i][j]
+			);
+		}
+	}
+}
+
 /*============================================================================*
  * Benchmark                                                                  *
  *============================================================================*/
 
 /**
- * @brief Server information.
+ * @brief Requests.
  */
-struct
-{
-	kthread_t tids[NTHREADS_MAX];      /**< IDs of Worker Threads         */
-	int nworkers;                      /**< Number of Worker Threads      */
-	struct nanvix_mutex lock;          /**< Server Lock                   */
-	struct nanvix_semaphore workers;   /**< Number of Idle Worker Threads */
-} sinfo;
+static struct request requests[NREQUESTS];
 
 /**
- * @brief Worker threads.
+ * @brief Request latencies.
  */
-struct winfo
-{
-	int idle;                       /**< Idle Worker?      */
-	int request;                    /**< Current Request   */
-	float scratch;                  /**< scratch variable. */
-	struct nanvix_semaphore wakeup; /**< Wake Up Worker?   */
-} workers[NTHREADS_MAX];
+static uint64_t latencies[NREQUESTS];
 
 /**
- * @brief Performs CPU intensive computation
+ * @brief Latency histograms of request phases.
  */
-static void do_work(float *scratch)
-{
-	register float tmp = *scratch;
+static uint32_t histograms[PHASE_NUM][HISTOGRAM_BINS];
 
-	for (int k = 0; k < FLOPS; k += 9)
+/**
+ * @brief Builds latency histograms of the phases of served requests.
+ *
+ * @param nrequests Number of requests.
+ */
+static void breakdown_collect(int nrequests)
+{
+	for (int i = 0; i < PHASE_NUM; i++)
 	{
-		register float k1 = k*1.1;
-		register float k2 = k*2.1;
-		register float k3 = k*3.1;
-		register float k4 = k*4.1;
-
-		tmp += k1 + k2 + k3 + k4;
+		for (int j = 0; j < HISTOGRAM_BINS; j++)
+			histograms[i][j] = 0;
 	}
 
-	/* Avoid compiler optimizations. */
-	*scratch = tmp;
+	for (int i = 0; i < nrequests; i++)
+	{
+		histogram_add(histograms[PHASE_QUEUEING], requests[i].dispatch - requests[i].enqueue);
+		histogram_add(histograms[PHASE_WAKEUP], requests[i].wakeup - requests[i].dispatch);
+		histogram_add(histograms[PHASE_SERVICE], requests[i].end - requests[i].start);
+	}
 }
+
 /**
- * @brief Worker thread.
+ * @brief A simple multi-thread server.
+ *
+ * @param engine    Server engine.
+ * @param nworkers  Number of worker threads.
+ * @param nrequests Number of requests.
  */
-static void *worker(void *arg)
+static void server(const struct server_engine *engine, int nworkers, int nrequests)
 {
-	struct winfo *t = arg;
+	uint64_t t0;
+	uint64_t t1;
+	uint64_t calls;
+	uint64_t uland_stats[BENCHMARK_PERF_EVENTS];
+	uint64_t kland_stats[BENCHMARK_PERF_EVENTS];
 
-	while (1)
-	{
-		nanvix_semaphore_down(&t->wakeup);
+	workload_generate(requests, nrequests, SERVICE_FIXED, 0);
 
-		/* Shutdown signal. */
-		if (t->request == -1)
-			break;
+	engine->startup(nworkers);
 
-		do_work(&t->scratch);
+		for (int k = 0; k < NITERATIONS + SKIP; k++)
+		{
+			for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+			{
+				perf_start(0, perf_events[j]);
+				kstats(NULL, perf_events[j]);
+				calls = engine->syscalls();
+				kclock(&t0);
 
-		nanvix_mutex_lock(&sinfo.lock);
-			t->idle = 1;
-		nanvix_mutex_unlock(&sinfo.lock);
-		nanvix_semaphore_up(&sinfo.workers);
-	}
+					for (int n = 0; n < nrequests; n++)
+					{
+						kclock(&requests[n].enqueue);
+						engine->dispatch(&requests[n]);
+					}
 
-	return (NULL);
+					engine->drain();
+
+				kclock(&t1);
+				calls = engine->syscalls() - calls;
+				kstats(&kland_stats[j], 0);
+				perf_stop(0);
+				uland_stats[j] = perf_read(0);
+			}
+
+			if (k >= SKIP)
+			{
+				benchmark_dump_stats(
+					k - SKIP,
+					BENCHMARK_NAME,
+					uland_stats,
+					kland_stats
+				);
+
+				benchmark_dump_latency(
+					k - SKIP,
+					BENCHMARK_NAME,
+					t1 - t0,
+					calls,
+					requests,
+					nrequests
+				);
+
+				breakdown_collect(nrequests);
+				benchmark_dump_breakdown(
+					k - SKIP,
+					BENCHMARK_NAME,
+					histograms
+				);
+			}
+		}
+
+	engine->shutdown();
 }
 
+/*============================================================================*
+ * Open-Loop Client                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Arrival processes.
+ */
+enum arrival
+{
+	ARRIVAL_CONSTANT, /**< Fixed Inter-Arrival Time        */
+	ARRIVAL_POISSON,  /**< Exponential Inter-Arrival Time */
+	ARRIVAL_NUM       /**< Number of Arrival Processes    */
+};
+
+/**
+ * @brief Names of arrival processes.
+ */
+static const char *arrival_names[ARRIVAL_NUM] = {
+	"constant",
+	"poisson",
+};
+
 /**
- * @brief Starts up the sinfo.
+ * @brief Measures the service time of requests.
  *
- * @param nworkers  Number of worker threads.
+ * @param nrequests Number of requests.
+ *
+ * @returns The mean service time of a request (in cycles).
  */
-static void server_startup(int nworkers)
+static uint64_t service_time(int nrequests)
 {
-	/* Initialize sinfo. */
-	sinfo.nworkers = nworkers;
-	nanvix_mutex_init(&sinfo.lock);
-	nanvix_semaphore_init(&sinfo.workers, nworkers);
+	float scratch = 0.0;
+	uint64_t sum = 0;
 
-	/* Spawn worker threads. */
-	for (int i = 0; i < nworkers; i++)
+	for (int i = 0; i < nrequests; i++)
 	{
-		workers[i].idle = 1;
-		nanvix_semaphore_init(&workers[i].wakeup, 0);
-		kthread_create(&sinfo.tids[i], worker, &workers[i]);
+		request_serve(&requests[i], &scratch);
+		sum += requests[i].end - requests[i].start;
 	}
+
+	return (sum/nrequests);
 }
 
 /**
- * @brief Shuts down the sinfo.
+ * @brief Collects the latencies of requests.
+ *
+ * @param nrequests Number of requests.
+ * @param type      Request type (REQUEST_NUM for all).
+ *
+ * @returns The number of collected latencies.
  */
-static void server_shutdown(void)
+static int latencies_collect(int nrequests, int type)
 {
-again:
+	int n = 0;
 
-	nanvix_mutex_lock(&sinfo.lock);
+	for (int i = 0; i < nrequests; i++)
+	{
+		if ((type == REQUEST_NUM) || (requests[i].type == type))
+			latencies[n++] = requests[i].end - requests[i].enqueue;
+	}
+
+	samples_sort(latencies, n);
+
+	return (n);
+}
 
-		/* Broadcast shutdown signal. */
-		for (int i = 0; i < sinfo.nworkers; i++)
+/**
+ * @brief Open-loop server run.
+ *
+ * @param engine    Server engine.
+ * @param arrival   Arrival process.
+ * @param interval  Mean inter-arrival time (in cycles).
+ * @param nrequests Number of requests.
+ *
+ * @returns The elapsed time from the first arrival to the last
+ * completion (in cycles).
+ *
+ * @details Requests arrive at scheduled times regardless of whether
+ * workers are idle. Arrived requests that could not be dispatched yet
+ * wait in a FIFO queue, so their latency includes queueing delay. The
+ * enqueue timestamp of a request is its scheduled arrival time, thus
+ * lagging behind the schedule does not hide latency.
+ */
+static uint64_t server_open(
+	const struct server_engine *engine,
+	enum arrival arrival,
+	uint64_t interval,
+	int nrequests
+)
+{
+	int head;                /* Next request to dispatch. */
+	int tail;                /* Next request to arrive.   */
+	uint64_t now;            /* Current time.             */
+	uint64_t next;           /* Next arrival time.        */
+	uint64_t last;           /* Last completion time.     */
+	uint32_t seed = 13;      /* Random seed.              */
+
+	head = 0;
+	tail = 0;
+	kclock(&next);
+
+	while (head < nrequests)
+	{
+		kclock(&now);
+
+		/* Enqueue arrived requests. */
+		while ((tail < nrequests) && (next <= now))
 		{
-			if (!workers[i].idle)
-			{
-				nanvix_mutex_unlock(&sinfo.lock);
-				goto again;
-			}
+			requests[tail].enqueue = next;
+			tail++;
 
-			/* Shutdown signal. */
-			workers[i].request = -1;
-			nanvix_semaphore_up(&workers[i].wakeup);
+			next += (arrival == ARRIVAL_POISSON) ?
+				(uint64_t) rand_exponential(&seed, (float) interval) : interval;
 		}
 
-	nanvix_mutex_unlock(&sinfo.lock);
+		/* Dispatch head of the queue. */
+		if ((head < tail) && (engine->trydispatch(&requests[head]) == 0))
+			head++;
+	}
+
+	engine->drain();
 
-	/* Join worker threads. */
-	for (int i = 0; i < sinfo.nworkers; i++)
-		kthread_join(sinfo.tids[i], NULL);
+	last = 0;
+	for (int i = 0; i < nrequests; i++)
+	{
+		if (requests[i].end > last)
+			last = requests[i].end;
+	}
 
+	return (last - requests[0].enqueue);
 }
 
 /**
- * @brief A simple multi-thread server.
+ * @brief Sweeps offered load until the server saturates.
  *
+ * @param engine    Server engine.
  * @param nworkers  Number of worker threads.
  * @param nrequests Number of requests.
+ *
+ * @details The sweep is repeated for every service time distribution,
+ * and latency percentiles are reported for all requests and for each
+ * request type separately.
  */
-static void server(int nworkers, int nrequests)
+static void server_sweep(const struct server_engine *engine, int nworkers, int nrequests)
 {
-	uint64_t uland_stats[BENCHMARK_PERF_EVENTS];
-	uint64_t kland_stats[BENCHMARK_PERF_EVENTS];
+	engine->startup(nworkers);
 
-	server_startup(nworkers);
+	for (int dist = 0; dist < SERVICE_NUM; dist++)
+	{
+		uint64_t service;
 
-		for (int k = 0; k < NITERATIONS + SKIP; k++)
+		workload_generate(requests, nrequests, dist, MEMORY_RATIO);
+		service = service_time(nrequests);
+
+		for (int arrival = 0; arrival < ARRIVAL_NUM; arrival++)
 		{
-			for (int j = 0; j < BENCHMARK_PERF_EVENTS; j++)
+			for (int load = LOAD_MIN; load <= LOAD_MAX; load += LOAD_STEP)
 			{
-				int n = 0;
-
-				perf_start(0, perf_events[j]);
-				kstats(NULL, perf_events[j]);
+				int saturated = 0;
+				uint64_t interval = (service*100)/(nworkers*load);
+				uint64_t offered = cycles_to_rate(1, interval);
 
-				do
+				for (int k = 0; k < NITERATIONS + SKIP; k++)
 				{
-					nanvix_semaphore_down(&sinfo.workers);
-					nanvix_mutex_lock(&sinfo.lock);
+					uint64_t achieved = cycles_to_rate(
+						nrequests,
+						server_open(engine, arrival, interval, nrequests)
+					);
+
+					if (k < SKIP)
+						continue;
 
-					/* Dispatch request to an idle worker thread. */
-					for (int i = 0; i < nworkers; i++)
+					for (int type = 0; type <= REQUEST_NUM; type++)
 					{
-						if (workers[i].idle)
-						{
-							workers[i].request = n++;
-							workers[i].idle = 0;
-							nanvix_semaphore_up(&workers[i].wakeup);
-							break;
-						}
+						int n;
+
+						if ((n = latencies_collect(nrequests, type)) == 0)
+							continue;
+
+						benchmark_dump_percentiles(
+							k - SKIP,
+							BENCHMARK_NAME,
+							arrival_names[arrival],
+							service_names[dist],
+							(type == REQUEST_NUM) ? "all" : request_type_names[type],
+							load,
+							offered,
+							achieved,
+							latencies,
+							n
+						);
 					}
 
-					nanvix_mutex_unlock(&sinfo.lock);
-				} while (n < nrequests);
+					if (achieved*100 < offered*LOAD_SATURATION)
+						saturated = 1;
+				}
 
-				kstats(&kland_stats[j], 0);
-				perf_stop(0);
-				uland_stats[j] = perf_read(0);
-			}
-
-			if (k >= SKIP)
-			{
-				benchmark_dump_stats(
-					k - SKIP,
-					BENCHMARK_NAME,
-					uland_stats,
-					kland_stats
-				);
+				/* No point in pushing further. */
+				if (saturated)
+					break;
 			}
 		}
+	}
 
-	server_shutdown();
+	engine->shutdown();
 }
 
 #endif
@@ -389,17 +675,24 @@ int __main2(int argc, const char *argv[])
 
 	uprintf(HLINE);
 
+	for (unsigned i = 0; i < sizeof(engines)/sizeof(engines[0]); i++)
+	{
+		ENGINE = engines[i]->name;
+
 #ifndef NDEBUG
 
-	server(NWORKERS = NTHREADS_MAX, NREQUESTS);
+		server(engines[i], NWORKERS = NTHREADS_MAX, NREQUESTS);
 
 #else
 
-	for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
-		server(NWORKERS = nthreads, NREQUESTS);
+		for (int nthreads = NTHREADS_MIN; nthreads <= NTHREADS_MAX; nthreads += NTHREADS_STEP)
+			server(engines[i], NWORKERS = nthreads, NREQUESTS);
 
 #endif
 
+		server_sweep(engines[i], NWORKERS = NTHREADS_MAX, NREQUESTS);
+	}
+
 	uprintf(HLINE);
 
 #endif
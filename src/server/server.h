@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+	#include <nanvix/sys/thread.h>
+	#include <nanvix/sys/mutex.h>
+	#include <nanvix/sys/semaphore.h>
+	#include <nanvix/ulib.h>
+	#include <posix/stdint.h>
+	#include <kbench.h>
+
+	/**
+	 * @name Benchmark Parameters
+	 */
+	/**@{*/
+	#define NTHREADS_MIN                1  /**< Minimum Number of Worker Threads      */
+	#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Worker Threads      */
+	#define NTHREADS_STEP               1  /**< Increment on Number of Worker Threads */
+	#define NREQUESTS                1000  /**< Number of Requests                    */
+	#define FLOPS                   10008  /**< Number of Floating Point Operations   */
+	/**@}*/
+
+	/**
+	 * @name Open-Loop Parameters
+	 *
+	 * @details Offered load is given in percent of the nominal capacity
+	 * of the server, which is the number of workers over the mean
+	 * service time of a request.
+	 */
+	/**@{*/
+	#define LOAD_MIN                   10  /**< Minimum Offered Load (%)              */
+	#define LOAD_MAX                  150  /**< Maximum Offered Load (%)              */
+	#define LOAD_STEP                  10  /**< Increment on Offered Load (%)         */
+	#define LOAD_SATURATION            95  /**< Achieved/Offered Load at Saturation   */
+	/**@}*/
+
+	/**
+	 * @name Workload Parameters
+	 *
+	 * @details Costs are given in floating point operations, which
+	 * memory-bound requests replace by cache-missing loads. The bimodal
+	 * distribution has the same mean as the fixed one and the Pareto
+	 * distribution (shape 1) spans BOUND_MIN to BOUND_MAX.
+	 */
+	/**@{*/
+	#define MEMORY_RATIO               20  /**< Memory-Bound Requests (%)             */
+	#define MEMWORK_SIZE        (64*1024)  /**< Footprint of Memory-Bound Work        */
+	#define BIMODAL_SHORT       (FLOPS/2)  /**< Cost of Short Requests                */
+	#define BIMODAL_LONG   ((FLOPS*11)/2)  /**< Cost of Long Requests                 */
+	#define BIMODAL_RATIO              10  /**< Long Requests (%)                     */
+	#define BOUND_MIN           (FLOPS/8)  /**< Minimum Cost (Pareto)                 */
+	#define BOUND_MAX         (FLOPS*100)  /**< Maximum Cost (Pareto)                 */
+	/**@}*/
+
+	/**
+	 * @brief Request types.
+	 */
+	enum request_type
+	{
+		REQUEST_CPU, /**< CPU-Bound Request    */
+		REQUEST_MEM, /**< Memory-Bound Request */
+		REQUEST_NUM  /**< Number of Types      */
+	};
+
+	/**
+	 * @brief Service time distributions.
+	 */
+	enum service_dist
+	{
+		SERVICE_FIXED,       /**< All Requests Cost the Same     */
+		SERVICE_BIMODAL,     /**< Mostly Short, Some Long        */
+		SERVICE_EXPONENTIAL, /**< Exponential Costs              */
+		SERVICE_PARETO,      /**< Heavy-Tailed Costs             */
+		SERVICE_NUM          /**< Number of Distributions        */
+	};
+
+	/**
+	 * @brief Request.
+	 */
+	struct request
+	{
+		int id;            /**< Request ID           */
+		int type;          /**< Request Type         */
+		int cost;          /**< Request Cost         */
+		uint64_t enqueue;  /**< Enqueue Timestamp    */
+		uint64_t dispatch; /**< Dispatch Timestamp   */
+		uint64_t wakeup;   /**< Wakeup Timestamp     */
+		uint64_t start;    /**< Start Timestamp      */
+		uint64_t end;      /**< Completion Timestamp */
+	};
+
+	/**
+	 * @brief Server engine.
+	 *
+	 * @details Engines count every mutex and semaphore call, failed
+	 * ones included, that the dispatcher and the workers issue to serve
+	 * requests. Calls issued by startup, drain and shutdown are left out,
+	 * so that counts are comparable across engines.
+	 */
+	struct server_engine
+	{
+		const char *name;                        /**< Engine Name                     */
+		void (*startup)(int nworkers);           /**< Spawns worker threads.          */
+		void (*dispatch)(struct request *req);   /**< Hands a request to the workers. */
+		int (*trydispatch)(struct request *req); /**< Same, but without blocking.     */
+		void (*drain)(void);                     /**< Waits pending requests.         */
+		uint64_t (*syscalls)(void);              /**< Counts blocking calls so far.   */
+		void (*shutdown)(void);                  /**< Joins worker threads.           */
+	};
+
+	/**
+	 * @name Server Engines
+	 */
+	/**@{*/
+	extern const struct server_engine engine_central;
+	extern const struct server_engine engine_steal;
+	extern const struct server_engine engine_batch;
+	/**@}*/
+
+	/**
+	 * @name Names of Request Types and Service Distributions
+	 */
+	/**@{*/
+	extern const char *request_type_names[REQUEST_NUM];
+	extern const char *service_names[SERVICE_NUM];
+	/**@}*/
+
+	/**
+	 * @brief Generates the type and cost of requests.
+	 *
+	 * @param reqs     Target requests.
+	 * @param nreqs    Number of requests.
+	 * @param dist     Service time distribution.
+	 * @param memratio Memory-bound requests (in percent).
+	 */
+	extern void workload_generate(
+		struct request *reqs,
+		int nreqs,
+		enum service_dist dist,
+		int memratio
+	);
+
+	/**
+	 * @brief Serves a request.
+	 *
+	 * @param req     Target request.
+	 * @param scratch Scratch variable of the calling worker.
+	 */
+	extern void request_serve(struct request *req, float *scratch);
+
+#endif /* _SERVER_H_ */
@@ -0,0 +1,339 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "server.h"
+
+#ifndef __qemu_riscv32__
+
+/*============================================================================*
+ * Work-Stealing Dispatcher                                                   *
+ *============================================================================*/
+
+/**
+ * @brief Capacity of a work deque (power of two).
+ */
+#define DEQUE_SIZE 64
+
+/**
+ * @brief Worker threads.
+ */
+static struct wsworker
+{
+	int wid;                           /**< Worker ID              */
+	int top;                           /**< Steal End of the Deque */
+	int bottom;                        /**< Owner End of the Deque */
+	int sleeping;                      /**< Sleeping on Wakeup?    */
+	int shutdown;                      /**< Shutdown Signal        */
+	int completed;                     /**< Completed Requests     */
+	uint64_t calls;                    /**< Semaphore Calls        */
+	float scratch;                     /**< Scratch Variable       */
+	spinlock_t lock;                   /**< Deque Lock             */
+	struct nanvix_semaphore wakeup;    /**< Wake Up Worker?        */
+	struct request *deque[DEQUE_SIZE]; /**< Work Deque             */
+} wsworkers[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Server information.
+ */
+static struct
+{
+	kthread_t tids[NTHREADS_MAX]; /**< IDs of Worker Threads       */
+	int nworkers;                 /**< Number of Worker Threads    */
+	int next;                     /**< Next Deque to Push Into     */
+	int dispatched;               /**< Number of Pushed Requests   */
+	uint64_t calls;               /**< Semaphore Calls             */
+} wsinfo;
+
+/**
+ * @brief Pops the newest request from the deque of a worker.
+ *
+ * @param w Owner of the deque.
+ *
+ * @returns The popped request, or NULL if the deque is empty.
+ */
+static struct request *deque_pop(struct wsworker *w)
+{
+	struct request *req = NULL;
+
+	spinlock_lock(&w->lock);
+
+		if (w->bottom != w->top)
+			req = w->deque[--w->bottom & (DEQUE_SIZE - 1)];
+
+	spinlock_unlock(&w->lock);
+
+	return (req);
+}
+
+/**
+ * @brief Steals the oldest request from the deque of some other worker.
+ *
+ * @param w Thief worker.
+ *
+ * @returns The stolen request, or NULL if all deques are empty.
+ */
+static struct request *deque_steal(struct wsworker *w)
+{
+	struct request *req = NULL;
+
+	for (int i = 1; (i < wsinfo.nworkers) && (req == NULL); i++)
+	{
+		struct wsworker *victim = &wsworkers[(w->wid + i)%wsinfo.nworkers];
+
+		spinlock_lock(&victim->lock);
+
+			if (victim->bottom != victim->top)
+				req = victim->deque[victim->top++ & (DEQUE_SIZE - 1)];
+
+		spinlock_unlock(&victim->lock);
+	}
+
+	return (req);
+}
+
+/**
+ * @brief Worker thread.
+ */
+static void *ws_worker(void *arg)
+{
+	struct wsworker *w = arg;
+	struct request *req;
+
+	while (1)
+	{
+		int sleep;
+
+		/* Serve own requests first, then steal. */
+		if (((req = deque_pop(w)) != NULL) || ((req = deque_steal(w)) != NULL))
+		{
+			kclock(&req->wakeup);
+			request_serve(req, &w->scratch);
+
+			spinlock_lock(&w->lock);
+				w->completed++;
+			spinlock_unlock(&w->lock);
+
+			continue;
+		}
+
+		spinlock_lock(&w->lock);
+
+			/* Shutdown signal. */
+			if (w->shutdown)
+			{
+				spinlock_unlock(&w->lock);
+				break;
+			}
+
+			/*
+			 * Go to sleep only if nothing was pushed
+			 * in the meantime, otherwise the wakeup is lost.
+			 */
+			sleep = w->sleeping = (w->bottom == w->top);
+
+		spinlock_unlock(&w->lock);
+
+		if (sleep)
+		{
+			w->calls++;
+			nanvix_semaphore_down(&w->wakeup);
+		}
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Starts up the server.
+ *
+ * @param nworkers Number of worker threads.
+ */
+static void ws_startup(int nworkers)
+{
+	wsinfo.nworkers = nworkers;
+	wsinfo.next = 0;
+	wsinfo.dispatched = 0;
+	wsinfo.calls = 0;
+
+	/* Spawn worker threads. */
+	for (int i = 0; i < nworkers; i++)
+	{
+		wsworkers[i].wid = i;
+		wsworkers[i].top = 0;
+		wsworkers[i].bottom = 0;
+		wsworkers[i].sleeping = 0;
+		wsworkers[i].shutdown = 0;
+		wsworkers[i].completed = 0;
+		wsworkers[i].calls = 0;
+		wsworkers[i].scratch = 0.0;
+		spinlock_init(&wsworkers[i].lock);
+		nanvix_semaphore_init(&wsworkers[i].wakeup, 0);
+		kthread_create(&wsinfo.tids[i], ws_worker, &wsworkers[i]);
+	}
+}
+
+/**
+ * @brief Pushes a request in the deque of some worker.
+ *
+ * @param req Target request.
+ *
+ * @returns Zero if the request was pushed, and non-zero if all deques
+ * are full.
+ *
+ * @details Deques are filled in round-robin. The dispatcher only
+ * touches the lock of the target deque, so it does not serialize
+ * with workers that are serving or stealing from other deques.
+ */
+static int ws_trydispatch(struct request *req)
+{
+	kclock(&req->dispatch);
+
+	for (int i = 0; i < wsinfo.nworkers; i++)
+	{
+		int pushed = 0;
+		int wakeup = 0;
+		struct wsworker *w = &wsworkers[wsinfo.next];
+
+		wsinfo.next = (wsinfo.next + 1)%wsinfo.nworkers;
+
+		spinlock_lock(&w->lock);
+
+			if ((w->bottom - w->top) < DEQUE_SIZE)
+			{
+				w->deque[w->bottom++ & (DEQUE_SIZE - 1)] = req;
+				pushed = 1;
+
+				if (w->sleeping)
+				{
+					w->sleeping = 0;
+					wakeup = 1;
+				}
+			}
+
+		spinlock_unlock(&w->lock);
+
+		if (wakeup)
+		{
+			wsinfo.calls++;
+			nanvix_semaphore_up(&w->wakeup);
+		}
+
+		if (pushed)
+		{
+			wsinfo.dispatched++;
+			return (0);
+		}
+	}
+
+	return (-1);
+}
+
+/**
+ * @brief Pushes a request in the deque of some worker.
+ *
+ * @param req Target request.
+ */
+static void ws_dispatch(struct request *req)
+{
+	while (ws_trydispatch(req) != 0)
+		/* noop */;
+}
+
+/**
+ * @brief Waits for all pushed requests to complete.
+ */
+static void ws_drain(void)
+{
+	int completed;
+
+	do
+	{
+		completed = 0;
+
+		for (int i = 0; i < wsinfo.nworkers; i++)
+		{
+			spinlock_lock(&wsworkers[i].lock);
+				completed += wsworkers[i].completed;
+			spinlock_unlock(&wsworkers[i].lock);
+		}
+	} while (completed < wsinfo.dispatched);
+}
+
+/**
+ * @brief Counts mutex and semaphore calls issued to serve requests.
+ */
+static uint64_t ws_syscalls(void)
+{
+	uint64_t calls = wsinfo.calls;
+
+	for (int i = 0; i < wsinfo.nworkers; i++)
+		calls += wsworkers[i].calls;
+
+	return (calls);
+}
+
+/**
+ * @brief Shuts down the server.
+ */
+static void ws_shutdown(void)
+{
+	/* Broadcast shutdown signal. */
+	for (int i = 0; i < wsinfo.nworkers; i++)
+	{
+		int wakeup;
+		struct wsworker *w = &wsworkers[i];
+
+		spinlock_lock(&w->lock);
+			w->shutdown = 1;
+			wakeup = w->sleeping;
+			w->sleeping = 0;
+		spinlock_unlock(&w->lock);
+
+		if (wakeup)
+			nanvix_semaphore_up(&w->wakeup);
+	}
+
+	/* Join worker threads. */
+	for (int i = 0; i < wsinfo.nworkers; i++)
+		kthread_join(wsinfo.tids[i], NULL);
+}
+
+/**
+ * @brief Work-stealing engine.
+ *
+ * @details Each worker owns a deque of requests. Workers serve their
+ * own deque from the newest end and, when it runs dry, steal from the
+ * oldest end of the other deques before going to sleep.
+ */
+const struct server_engine engine_steal = {
+	.name        = "steal",
+	.startup     = ws_startup,
+	.dispatch    = ws_dispatch,
+	.trydispatch = ws_trydispatch,
+	.drain       = ws_drain,
+	.syscalls    = ws_syscalls,
+	.shutdown    = ws_shutdown,
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "server.h"
+
+#ifndef __qemu_riscv32__
+
+/*============================================================================*
+ * Workload                                                                   *
+ *============================================================================*/
+
+/**
+ * @brief Names of request types.
+ */
+const char *request_type_names[REQUEST_NUM] = {
+	"cpu",
+	"mem",
+};
+
+/**
+ * @brief Names of service time distributions.
+ */
+const char *service_names[SERVICE_NUM] = {
+	"fixed",
+	"bimodal",
+	"exponential",
+	"pareto",
+};
+
+/**
+ * @brief Memory touched by memory-bound requests.
+ */
+static word_t memwork[MEMWORK_SIZE/WORD_SIZE] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Draws the cost of a request.
+ *
+ * @param dist Service time distribution.
+ * @param seed Random seed.
+ */
+static int workload_cost(enum service_dist dist, uint32_t *seed)
+{
+	int cost;
+
+	switch (dist)
+	{
+		case SERVICE_BIMODAL:
+			cost = ((rand_next(seed)%100) < BIMODAL_RATIO) ?
+				BIMODAL_LONG : BIMODAL_SHORT;
+			break;
+
+		case SERVICE_EXPONENTIAL:
+			cost = (int) rand_exponential(seed, FLOPS);
+			break;
+
+		/* Inverse of the bounded Pareto CDF, with shape 1. */
+		case SERVICE_PARETO:
+			cost = (int) (BOUND_MIN/(1.0f - rand_uniform(seed)*(1.0f - ((float) BOUND_MIN)/BOUND_MAX)));
+			break;
+
+		case SERVICE_FIXED:
+		default:
+			cost = FLOPS;
+			break;
+	}
+
+	return ((cost > 0) ? cost : 1);
+}
+
+/**
+ * @brief Generates the type and cost of requests.
+ *
+ * @param reqs     Target requests.
+ * @param nreqs    Number of requests.
+ * @param dist     Service time distribution.
+ * @param memratio Memory-bound requests (in percent).
+ */
+void workload_generate(
+	struct request *reqs,
+	int nreqs,
+	enum service_dist dist,
+	int memratio
+)
+{
+	uint32_t seed = 7;
+
+	for (int i = 0; i < nreqs; i++)
+	{
+		reqs[i].id = i;
+		reqs[i].type = ((int) (rand_next(&seed)%100) < memratio) ?
+			REQUEST_MEM : REQUEST_CPU;
+		reqs[i].cost = workload_cost(dist, &seed);
+	}
+}
+
+/**
+ * @brief Performs CPU intensive computation
+ *
+ * @param cost    Number of floating point operations.
+ * @param scratch Scratch variable.
+ */
+static void do_work(int cost, float *scratch)
+{
+	register float tmp = *scratch;
+
+	for (int k = 0; k < cost; k += 9)
+	{
+		register float k1 = k*1.1;
+		register float k2 = k*2.1;
+		register float k3 = k*3.1;
+		register float k4 = k*4.1;
+
+		tmp += k1 + k2 + k3 + k4;
+	}
+
+	/* Avoid compiler optimizations. */
+	*scratch = tmp;
+}
+
+/**
+ * @brief Performs memory intensive computation.
+ *
+ * @param first   First word to touch.
+ * @param cost    Number of floating point operations it stands for.
+ * @param scratch Scratch variable.
+ *
+ * @details There is one load per iteration of the CPU-bound loop.
+ * Loads are one cache line apart, so each one misses in the cache once
+ * the footprint exceeds it.
+ */
+static void do_memwork(int first, int cost, float *scratch)
+{
+	word_t sum = 0;
+	const int nwords = MEMWORK_SIZE/WORD_SIZE;
+	const int stride = CACHE_LINE_SIZE/WORD_SIZE;
+
+	for (int k = 0, i = first%nwords; k < cost; k += 9)
+	{
+		sum += memwork[i];
+
+		if ((i += stride) >= nwords)
+			i -= nwords;
+	}
+
+	/* Avoid compiler optimizations. */
+	*scratch += sum;
+}
+
+/**
+ * @brief Serves a request.
+ *
+ * @param req     Target request.
+ * @param scratch Scratch variable of the calling worker.
+ */
+void request_serve(struct request *req, float *scratch)
+{
+	kclock(&req->start);
+
+		if (req->type == REQUEST_MEM)
+			do_memwork(req->id*CACHE_LINE_SIZE/WORD_SIZE, req->cost, scratch);
+		else
+			do_work(req->cost, scratch);
+
+	kclock(&req->end);
+}
+
+#endif
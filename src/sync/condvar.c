@@ -0,0 +1,394 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/mutex.h>
+#include <nanvix/sys/semaphore.h>
+#include <nanvix/sys/condvar.h>
+#include "../comm/comm.h"
+#include "sync.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "sync"
+
+/*============================================================================*
+ * Wakeup Mechanisms                                                          *
+ *============================================================================*/
+
+/**
+ * @brief Wakeup channel.
+ *
+ * @details Wakeups are tokens, so that one issued before its waiter
+ * blocks is not lost with either mechanism.
+ */
+struct channel
+{
+	struct nanvix_mutex lock;    /**< Lock of Tokens      */
+	struct nanvix_cond_var cond; /**< Condition of Tokens */
+	int tokens;                  /**< Pending Wakeups     */
+	struct nanvix_semaphore sem; /**< Semaphore (Idiom)   */
+};
+
+/**
+ * @brief Initializes a channel on a condition variable.
+ */
+static void condvar_init(struct channel *ch)
+{
+	nanvix_mutex_init(&ch->lock);
+	nanvix_cond_init(&ch->cond);
+	ch->tokens = 0;
+}
+
+/**
+ * @brief Waits on a condition variable for a token.
+ */
+static void condvar_wait(struct channel *ch)
+{
+	nanvix_mutex_lock(&ch->lock);
+
+		while (ch->tokens == 0)
+			nanvix_cond_wait(&ch->cond, &ch->lock);
+
+		ch->tokens--;
+
+	nanvix_mutex_unlock(&ch->lock);
+}
+
+/**
+ * @brief Wakes up a waiter on a condition variable.
+ */
+static void condvar_signal(struct channel *ch)
+{
+	nanvix_mutex_lock(&ch->lock);
+
+		ch->tokens++;
+		nanvix_cond_signal(&ch->cond);
+
+	nanvix_mutex_unlock(&ch->lock);
+}
+
+/**
+ * @brief Wakes up n waiters on a condition variable.
+ */
+static void condvar_broadcast(struct channel *ch, int n)
+{
+	nanvix_mutex_lock(&ch->lock);
+
+		ch->tokens += n;
+		nanvix_cond_broadcast(&ch->cond);
+
+	nanvix_mutex_unlock(&ch->lock);
+}
+
+/**
+ * @brief Initializes a channel on a semaphore.
+ */
+static void semaphore_init(struct channel *ch)
+{
+	nanvix_semaphore_init(&ch->sem, 0);
+}
+
+/**
+ * @brief Waits on a semaphore.
+ */
+static void semaphore_wait(struct channel *ch)
+{
+	nanvix_semaphore_down(&ch->sem);
+}
+
+/**
+ * @brief Wakes up a waiter on a semaphore.
+ */
+static void semaphore_signal(struct channel *ch)
+{
+	nanvix_semaphore_up(&ch->sem);
+}
+
+/**
+ * @brief Wakes up n waiters on a semaphore, one at a time.
+ */
+static void semaphore_broadcast(struct channel *ch, int n)
+{
+	for (int i = 0; i < n; i++)
+		nanvix_semaphore_up(&ch->sem);
+}
+
+/**
+ * @brief Wakeup mechanisms.
+ */
+static const struct wakeup
+{
+	const char *name;                             /**< Mechanism Name */
+	void (*init)(struct channel *ch);             /**< Initializes    */
+	void (*wait)(struct channel *ch);             /**< Waits          */
+	void (*signal)(struct channel *ch);           /**< Wakes up one.  */
+	void (*broadcast)(struct channel *ch, int n); /**< Wakes up n.    */
+} wakeups[] = {
+	{ "condvar",   condvar_init,   condvar_wait,   condvar_signal,   condvar_broadcast   },
+	{ "semaphore", semaphore_init, semaphore_wait, semaphore_signal, semaphore_broadcast },
+};
+
+/**
+ * @brief Number of wakeup mechanisms.
+ */
+#define NWAKEUPS ((int) (sizeof(wakeups)/sizeof(wakeups[0])))
+
+/*============================================================================*
+ * Wakeup Benchmark                                                           *
+ *============================================================================*/
+
+/**
+ * @name Ping-Pong Channels
+ */
+/**@{*/
+static struct channel ping; /**< Ping */
+static struct channel pong; /**< Pong */
+/**@}*/
+
+/**
+ * @brief Answers pings.
+ */
+static void *task_wake(void *arg)
+{
+	const struct wakeup *w = arg;
+
+	for (int i = 0; i < NPINGS; i++)
+	{
+		w->wait(&ping);
+		w->signal(&pong);
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Wakeup Benchmark
+ *
+ * @details The master wakes up a partner thread and waits to be woken
+ * up back, as in the ping-pong benchmark, but through each wakeup
+ * mechanism.
+ */
+void benchmark_wakeup(void)
+{
+	uint64_t t0;
+	uint64_t t1;
+	kthread_t tid;
+
+	for (int k = 0; k < NWAKEUPS; k++)
+	{
+		const struct wakeup *w = &wakeups[k];
+
+		w->init(&ping);
+		w->init(&pong);
+
+		for (int it = 0; it < NITERATIONS + SKIP; it++)
+		{
+			kthread_create(&tid, task_wake, (void *) w);
+
+			kclock(&t0);
+
+				for (int i = 0; i < NPINGS; i++)
+				{
+					w->signal(&ping);
+					w->wait(&pong);
+				}
+
+			kclock(&t1);
+
+			kthread_join(tid, NULL);
+
+			if (it >= SKIP)
+			{
+				uprintf("[benchmarks][%s][wake] %d %s %d %d",
+					BENCHMARK_NAME,
+					it - SKIP,
+					w->name,
+					NPINGS,
+					UINT32((t1 - t0)/NPINGS)
+				);
+			}
+		}
+	}
+}
+
+/*============================================================================*
+ * Thundering Herd Benchmark                                                  *
+ *============================================================================*/
+
+/**
+ * @brief Channel of the herd.
+ */
+static struct channel herd;
+
+/**
+ * @brief Waiters that are about to block.
+ */
+static volatile int nwaiting;
+
+/**
+ * @brief Wakeup timestamps of waiters.
+ */
+static uint64_t wakes[THREAD_MAX];
+
+/**
+ * @brief Wakeup latencies of waiters.
+ */
+static uint64_t latencies[THREAD_MAX];
+
+/**
+ * @brief Thread info.
+ */
+static struct hdata
+{
+	int tid;                /**< Thread ID         */
+	int nwaiters;           /**< Number of Waiters */
+	const struct wakeup *w; /**< Wakeup Mechanism  */
+} hdata[THREAD_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Waits to be woken up with the rest of the herd.
+ */
+static void *task_herd(void *arg)
+{
+	struct hdata *t = arg;
+
+	barrier_cores_setup(t->tid, t->nwaiters + 1);
+
+	for (int it = 0; it < NITERATIONS + SKIP; it++)
+	{
+		barrier_cores();
+
+		__sync_fetch_and_add(&nwaiting, 1);
+		t->w->wait(&herd);
+		kclock(&wakes[t->tid]);
+
+		barrier_cores();
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	return (NULL);
+}
+
+/**
+ * @brief Dump results of the thundering herd benchmark.
+ *
+ * @param it       Benchmark iteration.
+ * @param name     Benchmark name.
+ * @param w        Wakeup mechanism.
+ * @param nwaiters Number of waiters.
+ * @param t0       Time of the broadcast.
+ */
+static void benchmark_dump_herd(
+	int it,
+	const char *name,
+	const struct wakeup *w,
+	int nwaiters,
+	uint64_t t0
+)
+{
+	for (int i = 0; i < nwaiters; i++)
+		latencies[i] = wakes[i + 1] - t0;
+
+	samples_sort(latencies, nwaiters);
+
+	uprintf("[benchmarks][%s][herd] %d %s %d %d %d %d",
+		name,
+		it,
+		w->name,
+		nwaiters,
+		UINT32(latencies[0]),
+		UINT32(samples_percentile(latencies, nwaiters, 500)),
+		UINT32(latencies[nwaiters - 1])
+	);
+}
+
+/**
+ * @brief Thundering Herd Benchmark
+ *
+ * @param nwaiters Number of waiters.
+ *
+ * @details The master wakes up all waiters at once and each of them
+ * takes the time it resumes. Waiters announce themselves before
+ * blocking, and the master lets HERD_DELAY cycles pass after the last
+ * announcement, so that all of them are asleep by the broadcast.
+ */
+void benchmark_herd(int nwaiters)
+{
+	kthread_t tids[THREAD_MAX];
+
+	for (int k = 0; k < NWAKEUPS; k++)
+	{
+		const struct wakeup *w = &wakeups[k];
+
+		w->init(&herd);
+		nwaiting = 0;
+
+		for (int i = 1; i <= nwaiters; i++)
+		{
+			hdata[i].tid = i;
+			hdata[i].nwaiters = nwaiters;
+			hdata[i].w = w;
+			kthread_create(&tids[i], task_herd, &hdata[i]);
+		}
+
+		barrier_cores_setup(0, nwaiters + 1);
+
+		for (int it = 0; it < NITERATIONS + SKIP; it++)
+		{
+			uint64_t t0;
+			uint64_t now;
+
+			barrier_cores();
+
+			while (nwaiting < nwaiters)
+				/* noop */;
+
+			kclock(&t0);
+			do
+				kclock(&now);
+			while ((now - t0) < HERD_DELAY);
+
+			kclock(&t0);
+			w->broadcast(&herd, nwaiters);
+
+			barrier_cores();
+
+			nwaiting = 0;
+
+			if (it >= SKIP)
+				benchmark_dump_herd(it - SKIP, BENCHMARK_NAME, w, nwaiters, t0);
+		}
+
+		barrier_cores_cleanup(0);
+
+		for (int i = 1; i <= nwaiters; i++)
+			kthread_join(tids[i], NULL);
+	}
+}
+
+#endif
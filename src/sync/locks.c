@@ -0,0 +1,376 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/mutex.h>
+#include <nanvix/sys/semaphore.h>
+#include "../comm/comm.h"
+#include "sync.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "sync"
+
+/*============================================================================*
+ * Locks                                                                      *
+ *============================================================================*/
+
+/**
+ * @name Locks
+ */
+/**@{*/
+static struct nanvix_mutex mutex;         /**< Mutex              */
+static struct nanvix_semaphore semaphore; /**< Semaphore (Binary) */
+static spinlock_t spinlock;               /**< Spinlock           */
+/**@}*/
+
+/**
+ * @brief Initializes the mutex.
+ */
+static void mutex_setup(void)
+{
+	nanvix_mutex_init(&mutex);
+}
+
+/**
+ * @brief Acquires the mutex.
+ */
+static void mutex_acquire(void)
+{
+	nanvix_mutex_lock(&mutex);
+}
+
+/**
+ * @brief Releases the mutex.
+ */
+static void mutex_release(void)
+{
+	nanvix_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Initializes the semaphore.
+ */
+static void semaphore_setup(void)
+{
+	nanvix_semaphore_init(&semaphore, 1);
+}
+
+/**
+ * @brief Acquires the semaphore.
+ */
+static void semaphore_acquire(void)
+{
+	nanvix_semaphore_down(&semaphore);
+}
+
+/**
+ * @brief Releases the semaphore.
+ */
+static void semaphore_release(void)
+{
+	nanvix_semaphore_up(&semaphore);
+}
+
+/**
+ * @brief Initializes the spinlock.
+ */
+static void spinlock_setup(void)
+{
+	spinlock_init(&spinlock);
+}
+
+/**
+ * @brief Acquires the spinlock.
+ */
+static void spinlock_acquire(void)
+{
+	spinlock_lock(&spinlock);
+}
+
+/**
+ * @brief Releases the spinlock.
+ */
+static void spinlock_release(void)
+{
+	spinlock_unlock(&spinlock);
+}
+
+/**
+ * @brief Lock kinds.
+ */
+static const struct lock_kind
+{
+	const char *name;      /**< Lock Name   */
+	void (*setup)(void);   /**< Initializes */
+	void (*acquire)(void); /**< Acquires    */
+	void (*release)(void); /**< Releases    */
+} lock_kinds[] = {
+	{ "mutex",     mutex_setup,     mutex_acquire,     mutex_release     },
+	{ "semaphore", semaphore_setup, semaphore_acquire, semaphore_release },
+	{ "spinlock",  spinlock_setup,  spinlock_acquire,  spinlock_release  },
+};
+
+/**
+ * @brief Number of lock kinds.
+ */
+#define NLOCK_KINDS ((int) (sizeof(lock_kinds)/sizeof(lock_kinds[0])))
+
+/*============================================================================*
+ * Lock Benchmark                                                             *
+ *============================================================================*/
+
+/**
+ * @name Shared State
+ *
+ * @details Only touched while holding the lock under test.
+ */
+/**@{*/
+static int owner;          /**< Last Thread to Acquire the Lock */
+static uint64_t nacquired; /**< Acquisitions by All Threads     */
+/**@}*/
+
+/**
+ * @brief Acquisitions of each thread.
+ */
+static uint64_t acquisitions[NTHREADS_MAX];
+
+/**
+ * @brief Thread info.
+ */
+static struct ldata
+{
+	int tid;                   /**< Thread ID                 */
+	int nthreads;              /**< Number of Peers           */
+	const struct lock_kind *l; /**< Lock Kind                 */
+	uint64_t nacquires;        /**< Own Acquisitions          */
+	uint64_t nhandoffs;        /**< Acquisitions from Others  */
+	uint64_t cycles;           /**< Time of All (Master Only) */
+} ldata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Acquires and releases a lock until threads acquire it
+ * NACQUIRES times each, on average.
+ *
+ * @details Threads race for acquisitions instead of taking a fixed
+ * share of them, so that an unfair lock shows in their counts. An
+ * acquisition is a handoff when the previous one was from another
+ * thread.
+ */
+static void *task_lock(void *arg)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	struct ldata *t = arg;
+	const struct lock_kind *l = t->l;
+	uint64_t target = t->nthreads*NACQUIRES;
+
+	barrier_cores_setup(t->tid, t->nthreads);
+
+	t->nacquires = 0;
+	t->nhandoffs = 0;
+
+	barrier_cores();
+	if (t->tid == 0)
+		kclock(&t0);
+
+	for (;;)
+	{
+		l->acquire();
+
+			if (nacquired == target)
+			{
+				l->release();
+				break;
+			}
+
+			nacquired++;
+			if (owner != t->tid)
+				t->nhandoffs++;
+			owner = t->tid;
+
+		l->release();
+
+		t->nacquires++;
+	}
+
+	barrier_cores();
+	if (t->tid == 0)
+	{
+		kclock(&t1);
+		t->cycles = t1 - t0;
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	return (NULL);
+}
+
+/**
+ * @brief Dump results of the lock benchmark.
+ *
+ * @param it       Benchmark iteration.
+ * @param name     Benchmark name.
+ * @param l        Lock kind.
+ * @param nthreads Number of working threads.
+ *
+ * @details Handoffs are given in permille of all acquisitions, and so
+ * is the fairness index of acquisitions per thread.
+ */
+static void benchmark_dump_locks(int it, const char *name, const struct lock_kind *l, int nthreads)
+{
+	uint64_t nhandoffs = 0;
+	uint64_t cycles = ldata[0].cycles;
+
+	for (int i = 0; i < nthreads; i++)
+	{
+		acquisitions[i] = ldata[i].nacquires;
+		nhandoffs += ldata[i].nhandoffs;
+	}
+
+	uprintf("[benchmarks][%s][lock] %d %s %d %d %d %d %d",
+		name,
+		it,
+		l->name,
+		nthreads,
+		UINT32(cycles/nacquired),
+		UINT32(cycles_to_rate(nacquired, cycles)),
+		UINT32((nhandoffs*1000)/nacquired),
+		UINT32(fairness_index(acquisitions, nthreads))
+	);
+}
+
+/**
+ * @brief Lock Benchmark
+ *
+ * @param nthreads Number of working threads.
+ *
+ * @details With a single thread, this measures the uncontended cost of
+ * acquiring and releasing each lock.
+ */
+void benchmark_locks(int nthreads)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	for (int k = 0; k < NLOCK_KINDS; k++)
+	{
+		lock_kinds[k].setup();
+
+		for (int it = 0; it < NITERATIONS + SKIP; it++)
+		{
+			owner = -1;
+			nacquired = 0;
+
+			for (int i = 0; i < nthreads; i++)
+			{
+				ldata[i].tid = i;
+				ldata[i].nthreads = nthreads;
+				ldata[i].l = &lock_kinds[k];
+				kthread_create(&tids[i], task_lock, &ldata[i]);
+			}
+
+			for (int i = 0; i < nthreads; i++)
+				kthread_join(tids[i], NULL);
+
+			if (it >= SKIP)
+				benchmark_dump_locks(it - SKIP, BENCHMARK_NAME, &lock_kinds[k], nthreads);
+		}
+	}
+}
+
+/*============================================================================*
+ * Ping-Pong Benchmark                                                        *
+ *============================================================================*/
+
+/**
+ * @name Ping-Pong Semaphores
+ */
+/**@{*/
+static struct nanvix_semaphore ping; /**< Ping */
+static struct nanvix_semaphore pong; /**< Pong */
+/**@}*/
+
+/**
+ * @brief Answers pings.
+ */
+static void *task_pong(void *arg)
+{
+	UNUSED(arg);
+
+	for (int i = 0; i < NPINGS; i++)
+	{
+		nanvix_semaphore_down(&ping);
+		nanvix_semaphore_up(&pong);
+	}
+
+	return (NULL);
+}
+
+/**
+ * @brief Ping-Pong Benchmark
+ *
+ * @details The master pings a partner thread through a semaphore and
+ * waits for its pong through another one. The reported latency is
+ * that of a round trip, thus two wakeups.
+ */
+void benchmark_pingpong(void)
+{
+	uint64_t t0;
+	uint64_t t1;
+	kthread_t tid;
+
+	nanvix_semaphore_init(&ping, 0);
+	nanvix_semaphore_init(&pong, 0);
+
+	for (int it = 0; it < NITERATIONS + SKIP; it++)
+	{
+		kthread_create(&tid, task_pong, NULL);
+
+		kclock(&t0);
+
+			for (int i = 0; i < NPINGS; i++)
+			{
+				nanvix_semaphore_up(&ping);
+				nanvix_semaphore_down(&pong);
+			}
+
+		kclock(&t1);
+
+		kthread_join(tid, NULL);
+
+		if (it >= SKIP)
+		{
+			uprintf("[benchmarks][%s][pingpong] %d %d %d",
+				BENCHMARK_NAME,
+				it - SKIP,
+				NPINGS,
+				UINT32((t1 - t0)/NPINGS)
+			);
+		}
+	}
+}
+
+#endif
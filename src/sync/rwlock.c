@@ -0,0 +1,419 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/mutex.h>
+#include <nanvix/sys/semaphore.h>
+#include "../comm/comm.h"
+#include "sync.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "sync"
+
+/**
+ * @brief Writes among operations (in percent).
+ */
+static const int write_ratios[] = { 0, 1, 10, 50 };
+
+/**
+ * @brief Number of write ratios.
+ */
+#define NWRITE_RATIOS ((int) (sizeof(write_ratios)/sizeof(write_ratios[0])))
+
+/*============================================================================*
+ * Read-Mostly Schemes                                                        *
+ *============================================================================*/
+
+/**
+ * @brief Shared table.
+ *
+ * @details Writers set all words to the same value, so that a reader
+ * that sees different ones has raced with a writer.
+ */
+static volatile word_t table[TABLE_WORDS] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Reads the shared table.
+ *
+ * @param copy Target copy.
+ */
+static inline void table_read(word_t *copy)
+{
+	for (int i = 0; i < TABLE_WORDS; i++)
+		copy[i] = table[i];
+}
+
+/**
+ * @brief Writes the shared table.
+ *
+ * @param value Target value.
+ */
+static inline void table_write(word_t value)
+{
+	for (int i = 0; i < TABLE_WORDS; i++)
+		table[i] = value;
+}
+
+/**
+ * @name Mutex Scheme
+ */
+/**@{*/
+static struct nanvix_mutex mutex; /**< Lock of the Table */
+/**@}*/
+
+/**
+ * @brief Initializes the mutex scheme.
+ */
+static void mutex_setup(void)
+{
+	nanvix_mutex_init(&mutex);
+}
+
+/**
+ * @brief Reads the table under the mutex.
+ */
+static void mutex_read(word_t *copy)
+{
+	nanvix_mutex_lock(&mutex);
+		table_read(copy);
+	nanvix_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Writes the table under the mutex.
+ */
+static void mutex_write(word_t value)
+{
+	nanvix_mutex_lock(&mutex);
+		table_write(value);
+	nanvix_mutex_unlock(&mutex);
+}
+
+/**
+ * @name Reader-Writer Lock Scheme
+ *
+ * @details The first reader in takes the table from writers and the
+ * last one out hands it back, so readers may starve writers.
+ */
+/**@{*/
+static struct nanvix_mutex rw_lock;     /**< Lock of Readers Count */
+static struct nanvix_semaphore rw_room; /**< Access to the Table   */
+static int rw_nreaders;                 /**< Readers in the Table  */
+/**@}*/
+
+/**
+ * @brief Initializes the reader-writer lock scheme.
+ */
+static void rwlock_setup(void)
+{
+	nanvix_mutex_init(&rw_lock);
+	nanvix_semaphore_init(&rw_room, 1);
+	rw_nreaders = 0;
+}
+
+/**
+ * @brief Reads the table under the reader-writer lock.
+ */
+static void rwlock_read(word_t *copy)
+{
+	nanvix_mutex_lock(&rw_lock);
+		if (rw_nreaders++ == 0)
+			nanvix_semaphore_down(&rw_room);
+	nanvix_mutex_unlock(&rw_lock);
+
+	table_read(copy);
+
+	nanvix_mutex_lock(&rw_lock);
+		if (--rw_nreaders == 0)
+			nanvix_semaphore_up(&rw_room);
+	nanvix_mutex_unlock(&rw_lock);
+}
+
+/**
+ * @brief Writes the table under the reader-writer lock.
+ */
+static void rwlock_write(word_t value)
+{
+	nanvix_semaphore_down(&rw_room);
+		table_write(value);
+	nanvix_semaphore_up(&rw_room);
+}
+
+/**
+ * @name Sequence Lock Scheme
+ *
+ * @details Writers bump the sequence number before and after writing,
+ * and readers retry until they see the same even number around their
+ * read. Readers never write shared memory.
+ */
+/**@{*/
+static spinlock_t seq_lock;   /**< Lock of Writers */
+static volatile unsigned seq; /**< Sequence Number */
+/**@}*/
+
+/**
+ * @brief Initializes the sequence lock scheme.
+ */
+static void seqlock_setup(void)
+{
+	spinlock_init(&seq_lock);
+	seq = 0;
+}
+
+/**
+ * @brief Reads the table under the sequence lock.
+ */
+static void seqlock_read(word_t *copy)
+{
+	unsigned s;
+
+	do
+	{
+		while ((s = seq) & 1)
+			/* noop */;
+
+		__sync_synchronize();
+		table_read(copy);
+		__sync_synchronize();
+	} while (seq != s);
+}
+
+/**
+ * @brief Writes the table under the sequence lock.
+ */
+static void seqlock_write(word_t value)
+{
+	spinlock_lock(&seq_lock);
+
+		seq++;
+		__sync_synchronize();
+		table_write(value);
+		__sync_synchronize();
+		seq++;
+
+	spinlock_unlock(&seq_lock);
+}
+
+/**
+ * @brief Read-mostly schemes.
+ */
+static const struct scheme
+{
+	const char *name;            /**< Scheme Name  */
+	void (*setup)(void);         /**< Initializes  */
+	void (*read)(word_t *copy);  /**< Reads Table  */
+	void (*write)(word_t value); /**< Writes Table */
+} schemes[] = {
+	{ "mutex",   mutex_setup,   mutex_read,   mutex_write   },
+	{ "rwlock",  rwlock_setup,  rwlock_read,  rwlock_write  },
+	{ "seqlock", seqlock_setup, seqlock_read, seqlock_write },
+};
+
+/**
+ * @brief Number of read-mostly schemes.
+ */
+#define NSCHEMES ((int) (sizeof(schemes)/sizeof(schemes[0])))
+
+/*============================================================================*
+ * Read-Mostly Benchmark                                                      *
+ *============================================================================*/
+
+/**
+ * @brief Thread info.
+ */
+static struct rdata
+{
+	int tid;                /**< Thread ID                 */
+	int nthreads;           /**< Number of Peers           */
+	int ratio;              /**< Writes (%)                */
+	uint32_t seed;          /**< Random Generator State    */
+	const struct scheme *s; /**< Read-Mostly Scheme        */
+	uint64_t nreads;        /**< Reads                     */
+	uint64_t nwrites;       /**< Writes                    */
+	uint64_t ntorn;         /**< Inconsistent Reads        */
+	uint64_t wsum;          /**< Sum of Write Latencies    */
+	uint64_t wmax;          /**< Longest Write Latency     */
+	uint64_t cycles;        /**< Time of All (Master Only) */
+} rdata[NTHREADS_MAX] ALIGN(CACHE_LINE_SIZE);
+
+/**
+ * @brief Reads and writes the shared table.
+ *
+ * @details Each operation is a write with the given odds. Writes are
+ * timed one by one, including the wait for readers to leave.
+ */
+static void *task_rw(void *arg)
+{
+	uint64_t t0 = 0;
+	uint64_t t1 = 0;
+	struct rdata *t = arg;
+	const struct scheme *s = t->s;
+	word_t copy[TABLE_WORDS];
+
+	barrier_cores_setup(t->tid, t->nthreads);
+
+	barrier_cores();
+	if (t->tid == 0)
+		kclock(&t0);
+
+	for (int i = 0; i < NRWOPS; i++)
+	{
+		if ((int) (rand_next(&t->seed)%100) < t->ratio)
+		{
+			uint64_t w0;
+			uint64_t w1;
+
+			kclock(&w0);
+				s->write(t->tid*NRWOPS + i);
+			kclock(&w1);
+
+			t->nwrites++;
+			t->wsum += w1 - w0;
+			if ((w1 - w0) > t->wmax)
+				t->wmax = w1 - w0;
+
+			continue;
+		}
+
+		s->read(copy);
+		t->nreads++;
+
+		for (int j = 1; j < TABLE_WORDS; j++)
+		{
+			if (copy[j] != copy[0])
+			{
+				t->ntorn++;
+				break;
+			}
+		}
+	}
+
+	barrier_cores();
+	if (t->tid == 0)
+	{
+		kclock(&t1);
+		t->cycles = t1 - t0;
+	}
+
+	barrier_cores_cleanup(t->tid);
+
+	return (NULL);
+}
+
+/**
+ * @brief Dump results of the read-mostly benchmark.
+ *
+ * @param it       Benchmark iteration.
+ * @param name     Benchmark name.
+ * @param s        Read-mostly scheme.
+ * @param nthreads Number of working threads.
+ * @param ratio    Writes (in percent).
+ */
+static void benchmark_dump_rw(
+	int it,
+	const char *name,
+	const struct scheme *s,
+	int nthreads,
+	int ratio
+)
+{
+	uint64_t nreads = 0;
+	uint64_t nwrites = 0;
+	uint64_t ntorn = 0;
+	uint64_t wsum = 0;
+	uint64_t wmax = 0;
+	uint64_t cycles = rdata[0].cycles;
+
+	for (int i = 0; i < nthreads; i++)
+	{
+		nreads += rdata[i].nreads;
+		nwrites += rdata[i].nwrites;
+		ntorn += rdata[i].ntorn;
+		wsum += rdata[i].wsum;
+		if (rdata[i].wmax > wmax)
+			wmax = rdata[i].wmax;
+	}
+
+	uprintf("[benchmarks][%s][rw] %d %s %d %d %d %d %d %d %d",
+		name,
+		it,
+		s->name,
+		nthreads,
+		ratio,
+		UINT32(cycles_to_rate(nreads, cycles)),
+		UINT32(cycles_to_rate(nwrites, cycles)),
+		UINT32((nwrites == 0) ? 0 : wsum/nwrites),
+		UINT32(wmax),
+		UINT32(ntorn)
+	);
+}
+
+/**
+ * @brief Read-Mostly Benchmark
+ *
+ * @param nthreads Number of working threads.
+ */
+void benchmark_rw(int nthreads)
+{
+	kthread_t tids[NTHREADS_MAX];
+
+	for (int k = 0; k < NSCHEMES; k++)
+	{
+		schemes[k].setup();
+
+		for (int r = 0; r < NWRITE_RATIOS; r++)
+		{
+			for (int it = 0; it < NITERATIONS + SKIP; it++)
+			{
+				table_write(0);
+
+				for (int i = 0; i < nthreads; i++)
+				{
+					rdata[i].tid = i;
+					rdata[i].nthreads = nthreads;
+					rdata[i].ratio = write_ratios[r];
+					rdata[i].seed = 2*i + 1;
+					rdata[i].s = &schemes[k];
+					rdata[i].nreads = 0;
+					rdata[i].nwrites = 0;
+					rdata[i].ntorn = 0;
+					rdata[i].wsum = 0;
+					rdata[i].wmax = 0;
+					kthread_create(&tids[i], task_rw, &rdata[i]);
+				}
+
+				for (int i = 0; i < nthreads; i++)
+					kthread_join(tids[i], NULL);
+
+				if (it >= SKIP)
+					benchmark_dump_rw(it - SKIP, BENCHMARK_NAME, &schemes[k], nthreads, write_ratios[r]);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <nanvix/sys/semaphore.h>
+#include "sync.h"
+
+#ifndef __qemu_riscv32__
+
+/**
+ * @brief Name of the benchmark.
+ */
+#define BENCHMARK_NAME "sync"
+
+/*============================================================================*
+ * Switch Mechanisms                                                          *
+ *============================================================================*/
+
+/**
+ * @name Ping-Pong Semaphores
+ */
+/**@{*/
+static struct nanvix_semaphore ping; /**< Ping */
+static struct nanvix_semaphore pong; /**< Pong */
+/**@}*/
+
+/**
+ * @brief Thread whose turn it is.
+ */
+static volatile int turn;
+
+/**
+ * @brief Initializes semaphores.
+ */
+static void semaphore_setup(void)
+{
+	nanvix_semaphore_init(&ping, 0);
+	nanvix_semaphore_init(&pong, 0);
+}
+
+/**
+ * @brief Passes the turn to pong through semaphores and waits for it back.
+ */
+static void semaphore_ping(void)
+{
+	nanvix_semaphore_up(&ping);
+	nanvix_semaphore_down(&pong);
+}
+
+/**
+ * @brief Waits for the turn through semaphores and passes it back.
+ */
+static void semaphore_pong(void)
+{
+	nanvix_semaphore_down(&ping);
+	nanvix_semaphore_up(&pong);
+}
+
+/**
+ * @brief Initializes the turn.
+ */
+static void yield_setup(void)
+{
+	turn = 0;
+}
+
+/**
+ * @brief Passes the turn to pong and yields until it comes back.
+ */
+static void yield_ping(void)
+{
+	turn = 1;
+	while (turn != 0)
+		kthread_yield();
+}
+
+/**
+ * @brief Yields until the turn comes and passes it back.
+ */
+static void yield_pong(void)
+{
+	while (turn != 1)
+		kthread_yield();
+	turn = 0;
+}
+
+/**
+ * @brief Switch mechanisms.
+ *
+ * @details The kernel places both threads as it will. On the same
+ * core, each round trip takes two context switches. Across cores, it
+ * takes two wakeups instead.
+ */
+static const struct mechanism
+{
+	const char *name;     /**< Mechanism Name */
+	void (*setup)(void);  /**< Initializes    */
+	void (*ping)(void);   /**< Round trip     */
+	void (*pong)(void);   /**< Answer         */
+} mechanisms[] = {
+	{ "semaphore", semaphore_setup, semaphore_ping, semaphore_pong },
+	{ "yield",     yield_setup,     yield_ping,     yield_pong     },
+};
+
+/**
+ * @brief Number of switch mechanisms.
+ */
+#define NMECHANISMS ((int) (sizeof(mechanisms)/sizeof(mechanisms[0])))
+
+/*============================================================================*
+ * Switch Benchmark                                                           *
+ *============================================================================*/
+
+/**
+ * @brief Round trip latencies.
+ */
+static uint64_t samples[NPINGS];
+
+/**
+ * @brief Time of all round trips.
+ */
+static uint64_t cycles;
+
+/**
+ * @brief Thread info.
+ */
+static struct sdata
+{
+	const struct mechanism *m; /**< Switch Mechanism */
+} sdata[2];
+
+/**
+ * @brief Pings the partner thread.
+ */
+static void *task_ping(void *arg)
+{
+	uint64_t t0;
+	uint64_t t1;
+	uint64_t s0;
+	uint64_t s1;
+	struct sdata *t = arg;
+
+	kclock(&t0);
+
+		for (int i = 0; i < NPINGS; i++)
+		{
+			kclock(&s0);
+				t->m->ping();
+			kclock(&s1);
+
+			samples[i] = s1 - s0;
+		}
+
+	kclock(&t1);
+
+	cycles = t1 - t0;
+
+	return (NULL);
+}
+
+/**
+ * @brief Answers pings.
+ */
+static void *task_pong(void *arg)
+{
+	struct sdata *t = arg;
+
+	for (int i = 0; i < NPINGS; i++)
+		t->m->pong();
+
+	return (NULL);
+}
+
+/**
+ * @brief Dump results of the switch benchmark.
+ *
+ * @param it   Benchmark iteration.
+ * @param name Benchmark name.
+ * @param m    Switch mechanism.
+ *
+ * @details Latencies are those of round trips, and throughput is given
+ * in one-way switches per second.
+ */
+static void benchmark_dump_switch(
+	int it,
+	const char *name,
+	const struct mechanism *m
+)
+{
+	samples_sort(samples, NPINGS);
+
+	uprintf("[benchmarks][%s][switch] %d %s %d %d %d %d %d %d %d",
+		name,
+		it,
+		m->name,
+		NPINGS,
+		UINT32(samples[0]),
+		UINT32(samples_percentile(samples, NPINGS, 500)),
+		UINT32(samples_percentile(samples, NPINGS, 990)),
+		UINT32(samples[NPINGS - 1]),
+		UINT32(cycles/NPINGS),
+		UINT32(cycles_to_rate(2*NPINGS, cycles))
+	);
+}
+
+/**
+ * @brief Context Switch Benchmark
+ *
+ * @details A pair of threads hand a turn back and forth, either
+ * blocking on semaphores or yielding the core while they poll.
+ */
+void benchmark_switch(void)
+{
+	kthread_t tids[2];
+
+	for (int k = 0; k < NMECHANISMS; k++)
+	{
+		for (int it = 0; it < NITERATIONS + SKIP; it++)
+		{
+			mechanisms[k].setup();
+
+			sdata[0].m = &mechanisms[k];
+			sdata[1].m = &mechanisms[k];
+
+			kthread_create(&tids[1], task_pong, &sdata[1]);
+			kthread_create(&tids[0], task_ping, &sdata[0]);
+
+			kthread_join(tids[0], NULL);
+			kthread_join(tids[1], NULL);
+
+			if (it >= SKIP)
+				benchmark_dump_switch(it - SKIP, BENCHMARK_NAME, &mechanisms[k]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2011-2019 The Maintainers of Nanvix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SYNC_H_
+#define _SYNC_H_
+
+	#include <nanvix/sys/thread.h>
+	#include <nanvix/ulib.h>
+	#include <posix/stdint.h>
+	#include <kbench.h>
+
+	/**
+	 * @name Benchmark Parameters
+	 */
+	/**@{*/
+	#define NTHREADS_MIN                1  /**< Minimum Number of Working Threads      */
+	#define NTHREADS_MAX  (THREAD_MAX - 1) /**< Maximum Number of Working Threads      */
+	#define NTHREADS_STEP               1  /**< Increment on Number of Working Threads */
+	#define NACQUIRES           (1 << 12)  /**< Acquisitions per Thread                */
+	#define NPINGS              (1 << 10)  /**< Round Trips of Ping-Pong               */
+	#define NRWOPS              (1 << 12)  /**< Read-Mostly Operations per Thread      */
+	#define TABLE_WORDS                16  /**< Words in the Read-Mostly Table         */
+	/**@}*/
+
+	/**
+	 * @brief Time waiters get to block before a broadcast (in cycles).
+	 */
+	#define HERD_DELAY (KBENCH_CLOCK_FREQ/10000)
+
+	/**
+	 * @name Lock Benchmarks
+	 */
+	/**@{*/
+	extern void benchmark_locks(int nthreads);
+	extern void benchmark_pingpong(void);
+	/**@}*/
+
+	/**
+	 * @name Wakeup Benchmarks
+	 */
+	/**@{*/
+	extern void benchmark_wakeup(void);
+	extern void benchmark_herd(int nwaiters);
+	/**@}*/
+
+	/**
+	 * @brief Read-Mostly Benchmark
+	 */
+	extern void benchmark_rw(int nthreads);
+
+	/**
+	 * @brief Context Switch Benchmark
+	 */
+	extern void benchmark_switch(void);
+
+#endif /* _SYNC_H_ */